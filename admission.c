@@ -0,0 +1,69 @@
+#include <stddef.h>
+#include <math.h>
+
+#include "admission.h"
+
+#define BUCKETS 4096 // client IPs tracked at once
+#define PROBES 8     // slots searched for an IP before sharing one
+
+typedef struct {
+    uint32_t ip;
+    int used;
+    double tokens;
+    double last; // time tokens was last brought up to date
+} Bucket;
+
+static Bucket buckets[BUCKETS];
+
+int admissionAllow(const AdmissionConfig *config, uint32_t ip, double now, int *retryAfter)
+{
+    if (config->rate <= 0)
+    {
+        return 1;
+    }
+
+    // linear probing; a bucket idle long enough to be full again is free
+    double refill = config->burst / config->rate;
+    uint32_t home = (ip * 2654435761u) % BUCKETS;
+    Bucket *b = NULL, *spare = NULL;
+    for (int i = 0; i < PROBES && b == NULL; i++)
+    {
+        Bucket *slot = &buckets[(home + i) % BUCKETS];
+        if (slot->used && slot->ip == ip)
+        {
+            b = slot;
+        }
+        else if (spare == NULL && (!slot->used || now - slot->last >= refill))
+        {
+            spare = slot;
+        }
+    }
+    if (b == NULL && spare != NULL)
+    {
+        b = spare;
+        b->used = 1;
+        b->ip = ip;
+        b->tokens = config->burst;
+        b->last = now;
+    }
+    if (b == NULL)
+    {
+        // every slot is busy: share the home bucket
+        b = &buckets[home];
+    }
+
+    b->tokens += (now - b->last) * config->rate;
+    if (b->tokens > config->burst)
+    {
+        b->tokens = config->burst;
+    }
+    b->last = now;
+
+    if (b->tokens >= 1)
+    {
+        b->tokens -= 1;
+        return 1;
+    }
+    *retryAfter = (int)ceil((1 - b->tokens) / config->rate);
+    return 0;
+}
@@ -0,0 +1,30 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <stdint.h>
+
+/**
+ * @brief Load limits of the server, set from the command line
+ */
+typedef struct {
+    int backlog;        // pending connections the kernel queues
+    int maxConnections; // open client connections
+    int maxQueries;     // search requests queued or running
+    double rate;        // searches per second per client IP, shared by clients behind one address
+    double burst;       // searches a client IP may send at once
+    double headerTimeout; // seconds to receive a request head
+    double bodyTimeout;   // seconds to receive a request body
+    double writeTimeout;  // seconds to send a response
+    double idleTimeout;   // seconds a kept-alive connection waits for a request
+} AdmissionConfig;
+
+/**
+ * @brief Takes a token from the bucket of a client IP
+ * @param ip IPv4 address of the client
+ * @param now current time in seconds
+ * @param retryAfter set to the seconds until a token is available when refused
+ * @return 1 if the request may proceed, 0 if it must be refused
+ */
+int admissionAllow(const AdmissionConfig *config, uint32_t ip, double now, int *retryAfter);
+
+#endif
@@ -0,0 +1,796 @@
+#define _GNU_SOURCE // strcasestr, qsort_r
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <strings.h> // strcasecmp, strncasecmp
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <sqlite3.h>
+
+#include "catalog.h"
+#include "similar.h"
+
+// columns of the courses table holding each filter dimension
+static const char *dimColumns[CATALOG_DIMS] = {"University", "Faculty", "Studylevel", "Semester"};
+
+// tables the catalog and the pages are built from; selected is not one of them
+static const char *fingerprintTables[] = {"courses", "subjectmap", "faculties", "universities"};
+
+typedef struct {
+    Catalog *cat;
+    uint32_t stringsCap;
+    uint32_t *slots; // open addressing table of string offsets + 1
+    uint32_t slotCount;
+    uint32_t used;
+} Interner;
+
+static uint32_t hashString(const char *s)
+{
+    uint32_t h = 2166136261u;
+    while (*s)
+    {
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    }
+    return h;
+}
+
+static int internGrow(Interner *in)
+{
+    uint32_t newCount = in->slotCount ? in->slotCount * 2 : 4096;
+    uint32_t *slots = calloc(newCount, sizeof(uint32_t));
+    if (slots == NULL)
+    {
+        return -1;
+    }
+    for (uint32_t i = 0; i < in->slotCount; i++)
+    {
+        if (in->slots[i] == 0)
+        {
+            continue;
+        }
+        uint32_t j = hashString(in->cat->strings + in->slots[i] - 1) & (newCount - 1);
+        while (slots[j])
+        {
+            j = (j + 1) & (newCount - 1);
+        }
+        slots[j] = in->slots[i];
+    }
+    free(in->slots);
+    in->slots = slots;
+    in->slotCount = newCount;
+    return 0;
+}
+
+/**
+ * @brief Stores s once in the string pool and returns its offset
+ */
+static int intern(Interner *in, const char *s, uint32_t *off)
+{
+    Catalog *cat = in->cat;
+    if (s == NULL)
+    {
+        s = "";
+    }
+    if (in->slotCount == 0 && internGrow(in) < 0)
+    {
+        return -1;
+    }
+
+    uint32_t j = hashString(s) & (in->slotCount - 1);
+    while (in->slots[j])
+    {
+        if (strcmp(cat->strings + in->slots[j] - 1, s) == 0)
+        {
+            *off = in->slots[j] - 1;
+            return 0;
+        }
+        j = (j + 1) & (in->slotCount - 1);
+    }
+
+    size_t len = strlen(s) + 1;
+    if (cat->stringsSize + len > in->stringsCap)
+    {
+        uint32_t cap = in->stringsCap ? in->stringsCap * 2 : 65536;
+        while (cap < cat->stringsSize + len)
+        {
+            cap *= 2;
+        }
+        char *strings = realloc(cat->strings, cap);
+        if (strings == NULL)
+        {
+            return -1;
+        }
+        cat->strings = strings;
+        in->stringsCap = cap;
+    }
+    memcpy(cat->strings + cat->stringsSize, s, len);
+    *off = cat->stringsSize;
+    cat->stringsSize += len;
+
+    in->slots[j] = *off + 1;
+    // keep the table at most half full
+    if (++in->used * 2 > in->slotCount && internGrow(in) < 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns the value id of string offset off in dimension dim
+ */
+static int valueId(Catalog *cat, int dim, uint32_t off)
+{
+    for (uint32_t i = 0; i < cat->valueCount[dim]; i++)
+    {
+        if (cat->values[dim][i] == off)
+        {
+            return i;
+        }
+    }
+    if (cat->valueCount[dim] == CATALOG_MAX_VALUES)
+    {
+        return -1;
+    }
+    cat->values[dim][cat->valueCount[dim]] = off;
+    return cat->valueCount[dim]++;
+}
+
+static int compareSuggestions(const void *a, const void *b, void *arg)
+{
+    const char *keys = arg;
+    const CatalogSuggestion *x = a, *y = b;
+    int rc = strcmp(keys + x->key, keys + y->key);
+    if (rc == 0)
+    {
+        return x->course < y->course ? -1 : x->course > y->course;
+    }
+    return rc;
+}
+
+/**
+ * @brief Builds the sorted typeahead index over course codes and names
+ */
+static int buildSuggestions(Catalog *cat)
+{
+    cat->suggestions = malloc(2 * (size_t)cat->courseCount * sizeof(CatalogSuggestion) + 1);
+    cat->suggestKeys = malloc(cat->stringsSize + 1);
+    if (cat->suggestions == NULL || cat->suggestKeys == NULL)
+    {
+        return -1;
+    }
+
+    // lowercased copy of the pool, so lookups compare bytes only
+    for (uint32_t i = 0; i < cat->stringsSize; i++)
+    {
+        cat->suggestKeys[i] = tolower((unsigned char)cat->strings[i]);
+    }
+    cat->suggestKeysSize = cat->stringsSize;
+
+    for (uint32_t i = 0; i < cat->courseCount; i++)
+    {
+        cat->suggestions[cat->suggestionCount++] = (CatalogSuggestion){cat->courses[i].code, i};
+        cat->suggestions[cat->suggestionCount++] = (CatalogSuggestion){cat->courses[i].course, i};
+    }
+    qsort_r(cat->suggestions, cat->suggestionCount, sizeof(CatalogSuggestion), compareSuggestions,
+            cat->suggestKeys);
+    return 0;
+}
+
+static int compareOptions(const void *a, const void *b, void *arg)
+{
+    const char *strings = arg;
+    return strcasecmp(strings + *(const uint32_t *)a, strings + *(const uint32_t *)b);
+}
+
+/**
+ * @brief Tells whether a stored value lists the option: equals it in the
+ * exact dimensions, has it as one of its parts in the others
+ */
+static int valueLists(int dim, const char *value, const char *option)
+{
+    if (dim == DIM_UNI || dim == DIM_FAC)
+    {
+        return strcmp(value, option) == 0;
+    }
+    size_t len, optionLen = strlen(option);
+    const char *part;
+    while ((part = catalogNextOption(&value, &len)) != NULL)
+    {
+        if (len == optionLen && strncasecmp(part, option, len) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Collects the filter options of every dimension and the courses
+ * listing each, once the value bitsets are built
+ */
+static int buildOptions(Catalog *cat, Interner *in)
+{
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        cat->options[dim] = malloc(CATALOG_MAX_VALUES * sizeof(uint32_t));
+        if (cat->options[dim] == NULL)
+        {
+            return -1;
+        }
+        for (uint32_t v = 0; v < cat->valueCount[dim]; v++)
+        {
+            if (dim == DIM_UNI || dim == DIM_FAC)
+            {
+                cat->options[dim][cat->optionCount[dim]++] = cat->values[dim][v];
+                continue;
+            }
+
+            // interning may move the pool, so the position is kept as an offset
+            size_t pos = 0;
+            while (1)
+            {
+                const char *value = catalogString(cat, cat->values[dim][v]);
+                const char *text = value + pos;
+                size_t len;
+                const char *part = catalogNextOption(&text, &len);
+                if (part == NULL)
+                {
+                    break;
+                }
+                pos = text - value;
+
+                int known = len == 0;
+                for (uint32_t o = 0; o < cat->optionCount[dim] && !known; o++)
+                {
+                    const char *option = catalogString(cat, cat->options[dim][o]);
+                    known = strlen(option) == len && strncasecmp(option, part, len) == 0;
+                }
+                if (known)
+                {
+                    continue;
+                }
+                if (cat->optionCount[dim] == CATALOG_MAX_VALUES)
+                {
+                    fprintf(stderr, "Error: too many distinct %s options\n", dimColumns[dim]);
+                    return -1;
+                }
+                char *copy = strndup(part, len);
+                uint32_t off;
+                int rc = copy ? intern(in, copy, &off) : -1;
+                free(copy);
+                if (rc < 0)
+                {
+                    return -1;
+                }
+                cat->options[dim][cat->optionCount[dim]++] = off;
+            }
+        }
+        qsort_r(cat->options[dim], cat->optionCount[dim], sizeof(uint32_t), compareOptions, cat->strings);
+
+        cat->optionBits[dim] = calloc((size_t)cat->optionCount[dim] * cat->bitsetWords + 1, sizeof(uint64_t));
+        if (cat->optionBits[dim] == NULL)
+        {
+            return -1;
+        }
+        for (uint32_t o = 0; o < cat->optionCount[dim]; o++)
+        {
+            uint64_t *bits = cat->optionBits[dim] + (size_t)o * cat->bitsetWords;
+            for (uint32_t v = 0; v < cat->valueCount[dim]; v++)
+            {
+                if (!valueLists(dim, catalogString(cat, cat->values[dim][v]),
+                                catalogString(cat, cat->options[dim][o])))
+                {
+                    continue;
+                }
+                const uint64_t *valueBits = cat->bitsets[dim] + (size_t)v * cat->bitsetWords;
+                for (uint32_t w = 0; w < cat->bitsetWords; w++)
+                {
+                    bits[w] |= valueBits[w];
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief FNV-1a hash of every column of every row of fingerprintTables,
+ * in rowid order, with the type and length of each value
+ * @return 0 on success, -1 on an SQL error
+ */
+static int fingerprintRows(sqlite3 *db, uint64_t *fingerprint)
+{
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (size_t t = 0; t < sizeof(fingerprintTables) / sizeof(fingerprintTables[0]); t++)
+    {
+        char sql[128];
+        sqlite3_stmt *stmt;
+        snprintf(sql, sizeof(sql), "SELECT * FROM \"%s\" ORDER BY rowid", fingerprintTables[t]);
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
+        {
+            return -1;
+        }
+
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            for (int col = 0; col < sqlite3_column_count(stmt); col++)
+            {
+                const unsigned char *data = sqlite3_column_blob(stmt, col);
+                uint32_t len = sqlite3_column_bytes(stmt, col);
+                unsigned char head[5] = {sqlite3_column_type(stmt, col), len, len >> 8, len >> 16, len >> 24};
+                for (int i = 0; i < 5; i++)
+                {
+                    h = (h ^ head[i]) * 0x100000001B3ull;
+                }
+                for (uint32_t i = 0; i < len; i++)
+                {
+                    h = (h ^ data[i]) * 0x100000001B3ull;
+                }
+            }
+        }
+        sqlite3_finalize(stmt);
+        if (rc != SQLITE_DONE)
+        {
+            return -1;
+        }
+        // end of table, so rows cannot move between tables unnoticed
+        h = (h ^ 0xFF) * 0x100000001B3ull;
+    }
+    *fingerprint = h;
+    return 0;
+}
+
+int catalogLoad(Catalog *cat, const char *dbPath)
+{
+    sqlite3 *db;
+    sqlite3_stmt *stmt = NULL;
+    Interner in = {cat, 0, NULL, 0, 0};
+    uint32_t courseCap = 0;
+    int rc;
+
+    memset(cat, 0, sizeof(*cat));
+
+    // taken before reading, so a file replaced meanwhile just reads as changed
+    if (catalogSourceStat(dbPath, &cat->source) < 0)
+    {
+        fprintf(stderr, "Can't open database: %s\n", dbPath);
+        return -1;
+    }
+
+    rc = sqlite3_open_v2(dbPath, &db, SQLITE_OPEN_READONLY, NULL);
+    if (rc != SQLITE_OK)
+    {
+        fprintf(stderr, "Can't open database: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return -1;
+    }
+
+    // one read transaction, so the fingerprint describes the rows loaded
+    if (sqlite3_exec(db, "BEGIN", 0, 0, NULL) != SQLITE_OK || fingerprintRows(db, &cat->source.fingerprint) < 0)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+        goto fail;
+    }
+
+    rc = sqlite3_prepare_v2(db,
+                            "SELECT c.id, c.Code, c.Course, c.Credits, c.University, c.Faculty, "
+                            "c.Studylevel, c.Semester, s.SubjectMap "
+                            "FROM courses c LEFT JOIN subjectmap s ON s.id = c.id ORDER BY c.id",
+                            -1, &stmt, NULL);
+    if (rc != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+        goto fail;
+    }
+
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        cat->values[dim] = malloc(CATALOG_MAX_VALUES * sizeof(uint32_t));
+        if (cat->values[dim] == NULL)
+        {
+            goto nomem;
+        }
+    }
+
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        if (cat->courseCount == courseCap)
+        {
+            courseCap = courseCap ? courseCap * 2 : 1024;
+            CatalogCourse *courses = realloc(cat->courses, courseCap * sizeof(CatalogCourse));
+            if (courses == NULL)
+            {
+                goto nomem;
+            }
+            cat->courses = courses;
+        }
+
+        CatalogCourse *c = &cat->courses[cat->courseCount];
+        c->id = sqlite3_column_int(stmt, 0);
+        c->credits = sqlite3_column_int(stmt, 3);
+        if (intern(&in, (const char *)sqlite3_column_text(stmt, 1), &c->code) < 0 ||
+            intern(&in, (const char *)sqlite3_column_text(stmt, 2), &c->course) < 0 ||
+            intern(&in, (const char *)sqlite3_column_text(stmt, 8), &c->subjectMap) < 0)
+        {
+            goto nomem;
+        }
+        for (int dim = 0; dim < CATALOG_DIMS; dim++)
+        {
+            uint32_t off;
+            if (intern(&in, (const char *)sqlite3_column_text(stmt, 4 + dim), &off) < 0)
+            {
+                goto nomem;
+            }
+            int value = valueId(cat, dim, off);
+            if (value < 0)
+            {
+                fprintf(stderr, "Error: too many distinct %s values\n", dimColumns[dim]);
+                goto fail;
+            }
+            c->value[dim] = value;
+        }
+        cat->courseCount++;
+    }
+    if (rc != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+        goto fail;
+    }
+
+    cat->bitsetWords = (cat->courseCount + 63) / 64;
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        cat->bitsets[dim] = calloc((size_t)cat->valueCount[dim] * cat->bitsetWords + 1, sizeof(uint64_t));
+        if (cat->bitsets[dim] == NULL)
+        {
+            goto nomem;
+        }
+        for (uint32_t i = 0; i < cat->courseCount; i++)
+        {
+            bitsetSet(cat->bitsets[dim] + (size_t)cat->courses[i].value[dim] * cat->bitsetWords, i);
+        }
+    }
+
+    if (buildOptions(cat, &in) < 0 || buildSuggestions(cat) < 0 || similarBuild(cat) < 0)
+    {
+        goto nomem;
+    }
+
+    free(in.slots);
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    fprintf(stderr, "Loaded %u courses into catalog\n", cat->courseCount);
+    return 0;
+
+nomem:
+    fprintf(stderr, "Not enough memory!\n");
+fail:
+    free(in.slots);
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    catalogFree(cat);
+    return -1;
+}
+
+int catalogSourceStat(const char *dbPath, CatalogSource *source)
+{
+    struct stat st;
+    if (stat(dbPath, &st) < 0)
+    {
+        return -1;
+    }
+    source->inode = st.st_ino;
+    source->size = st.st_size;
+    source->mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    return 0;
+}
+
+int catalogFingerprint(const char *dbPath, uint64_t *fingerprint)
+{
+    sqlite3 *db;
+    int rc = sqlite3_open_v2(dbPath, &db, SQLITE_OPEN_READONLY, NULL);
+    if (rc == SQLITE_OK)
+    {
+        rc = sqlite3_exec(db, "BEGIN", 0, 0, NULL);
+    }
+    if (rc != SQLITE_OK || fingerprintRows(db, fingerprint) < 0)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return -1;
+    }
+    sqlite3_close(db);
+    return 0;
+}
+
+void catalogFree(Catalog *cat)
+{
+    if (cat->mapping)
+    {
+        munmap(cat->mapping, cat->mappingSize);
+        memset(cat, 0, sizeof(*cat));
+        return;
+    }
+    free(cat->courses);
+    free(cat->strings);
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        free(cat->values[dim]);
+        free(cat->bitsets[dim]);
+        free(cat->options[dim]);
+        free(cat->optionBits[dim]);
+    }
+    free(cat->suggestions);
+    free(cat->suggestKeys);
+    free(cat->vectors);
+    memset(cat, 0, sizeof(*cat));
+}
+
+int catalogFind(const Catalog *cat, uint32_t id)
+{
+    // courses are loaded ordered by id
+    int lo = 0, hi = (int)cat->courseCount - 1;
+    while (lo <= hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (cat->courses[mid].id == id)
+        {
+            return mid;
+        }
+        if (cat->courses[mid].id < id)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    return -1;
+}
+
+void catalogFilterAdd(CatalogFilter *filter, int dim, const char *term)
+{
+    if (filter->termCount[dim] < CATALOG_MAX_TERMS)
+    {
+        filter->terms[dim][filter->termCount[dim]++] = term;
+    }
+}
+
+void catalogMatchTerm(const Catalog *cat, int dim, const char *term, uint64_t *bits)
+{
+    for (uint32_t v = 0; v < cat->valueCount[dim]; v++)
+    {
+        const char *value = catalogString(cat, cat->values[dim][v]);
+        int match;
+        if (dim == DIM_UNI || dim == DIM_FAC)
+        {
+            match = strcmp(value, term) == 0;
+        }
+        else
+        {
+            // same semantics as the "like '%term%'" of the SQL search
+            match = strcasestr(value, term) != NULL;
+        }
+        if (match)
+        {
+            const uint64_t *valueBits = cat->bitsets[dim] + (size_t)v * cat->bitsetWords;
+            for (uint32_t w = 0; w < cat->bitsetWords; w++)
+            {
+                bits[w] |= valueBits[w];
+            }
+        }
+    }
+}
+
+void catalogFilterBits(const Catalog *cat, const CatalogFilter *filter, int skipDim,
+                       uint64_t *bits, uint64_t *scratch)
+{
+    for (uint32_t w = 0; w < cat->bitsetWords; w++)
+    {
+        bits[w] = ~(uint64_t)0;
+    }
+    if (cat->courseCount % 64)
+    {
+        bits[cat->bitsetWords - 1] = ((uint64_t)1 << (cat->courseCount % 64)) - 1;
+    }
+
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        if (dim == skipDim || filter->termCount[dim] == 0)
+        {
+            continue;
+        }
+        memset(scratch, 0, cat->bitsetWords * sizeof(uint64_t));
+        for (int t = 0; t < filter->termCount[dim]; t++)
+        {
+            catalogMatchTerm(cat, dim, filter->terms[dim][t], scratch);
+        }
+        for (uint32_t w = 0; w < cat->bitsetWords; w++)
+        {
+            bits[w] &= scratch[w];
+        }
+    }
+}
+
+uint32_t catalogFacetCounts(const Catalog *cat, const CatalogFilter *filter, const char *nameTerm,
+                            uint32_t counts[CATALOG_DIMS][CATALOG_MAX_VALUES])
+{
+    uint32_t words = cat->bitsetWords;
+    uint32_t total = 0;
+
+    memset(counts, 0, CATALOG_DIMS * sizeof(counts[0]));
+    if (nameTerm && *nameTerm == '\0')
+    {
+        nameTerm = NULL;
+    }
+
+    // courses matching each dimension on its own, then the name term, the
+    // courses of one facet and the courses of one option
+    uint64_t *match = calloc((size_t)(CATALOG_DIMS + 3) * words + 1, sizeof(uint64_t));
+    if (match == NULL)
+    {
+        fprintf(stderr, "Not enough memory!\n");
+        return 0;
+    }
+    uint64_t *named = match + (size_t)CATALOG_DIMS * words;
+    uint64_t *others = named + words;
+    uint64_t *term = others + words;
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        uint64_t *bits = match + (size_t)dim * words;
+        if (filter->termCount[dim] == 0)
+        {
+            memset(bits, 0xFF, words * sizeof(uint64_t));
+            continue;
+        }
+        for (int t = 0; t < filter->termCount[dim]; t++)
+        {
+            catalogMatchTerm(cat, dim, filter->terms[dim][t], bits);
+        }
+    }
+    for (uint32_t i = 0; i < cat->courseCount; i++)
+    {
+        if (nameTerm == NULL || strcasestr(catalogString(cat, cat->courses[i].course), nameTerm))
+        {
+            bitsetSet(named, i);
+        }
+    }
+
+    for (uint32_t w = 0; w < words; w++)
+    {
+        uint64_t all = named[w];
+        for (int dim = 0; dim < CATALOG_DIMS; dim++)
+        {
+            all &= match[(size_t)dim * words + w];
+        }
+        total += __builtin_popcountll(all);
+    }
+
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        // rows of the facet of dim: every dimension but dim matches
+        for (uint32_t w = 0; w < words; w++)
+        {
+            others[w] = named[w];
+            for (int d = 0; d < CATALOG_DIMS; d++)
+            {
+                if (d != dim)
+                {
+                    others[w] &= match[(size_t)d * words + w];
+                }
+            }
+        }
+
+        // an option counts what searching for it returns, which by
+        // substring may include courses listing another option
+        for (uint32_t o = 0; o < cat->optionCount[dim]; o++)
+        {
+            const uint64_t *listed = cat->optionBits[dim] + (size_t)o * words;
+            uint64_t present = 0;
+            for (uint32_t w = 0; w < words; w++)
+            {
+                present |= others[w] & listed[w];
+            }
+            if (present == 0)
+            {
+                continue;
+            }
+            memset(term, 0, words * sizeof(uint64_t));
+            catalogMatchTerm(cat, dim, catalogString(cat, cat->options[dim][o]), term);
+            for (uint32_t w = 0; w < words; w++)
+            {
+                counts[dim][o] += __builtin_popcountll(others[w] & term[w]);
+            }
+        }
+    }
+
+    free(match);
+    return total;
+}
+
+const char *catalogNextOption(const char **text, size_t *len)
+{
+    const char *start = *text;
+    if (*start == '\0')
+    {
+        return NULL;
+    }
+    size_t n = strcspn(start, ",");
+    *text = start[n] ? start + n + 1 : start + n;
+
+    while (n > 0 && !isalnum((unsigned char)*start))
+    {
+        start++, n--;
+    }
+    while (n > 0 && !isalnum((unsigned char)start[n - 1]))
+    {
+        n--;
+    }
+    *len = n;
+    return start;
+}
+
+int catalogSuggest(const Catalog *cat, const char *prefix, const uint64_t *allowed, uint32_t *out, int k)
+{
+    char key[128];
+    size_t len = 0;
+
+    while (*prefix == ' ')
+    {
+        prefix++;
+    }
+    for (; prefix[len] && len < sizeof(key) - 1; len++)
+    {
+        key[len] = tolower((unsigned char)prefix[len]);
+    }
+    key[len] = '\0';
+    if (len == 0)
+    {
+        return 0;
+    }
+
+    // first entry not below the prefix
+    uint32_t lo = 0, hi = cat->suggestionCount;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (strcmp(cat->suggestKeys + cat->suggestions[mid].key, key) < 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    int found = 0;
+    for (uint32_t i = lo; i < cat->suggestionCount && found < k; i++)
+    {
+        const CatalogSuggestion *s = &cat->suggestions[i];
+        if (strncmp(cat->suggestKeys + s->key, key, len) != 0)
+        {
+            break;
+        }
+        if (allowed && !bitsetTest(allowed, s->course))
+        {
+            continue;
+        }
+        int seen = 0;
+        for (int j = 0; j < found && !seen; j++)
+        {
+            seen = out[j] == s->course;
+        }
+        if (!seen)
+        {
+            out[found++] = s->course;
+        }
+    }
+    return found;
+}
@@ -0,0 +1,202 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CATALOG_MAX_VALUES 256 // distinct values per filter dimension
+#define CATALOG_MAX_TERMS 32   // filter terms per dimension in one query
+
+/**
+ * @brief Filter dimensions of the course search forms
+ */
+enum
+{
+    DIM_UNI,      // University, exact match
+    DIM_FAC,      // Faculty, exact match
+    DIM_DEGREE,   // Studylevel, substring match
+    DIM_SEMESTER, // Semester, substring match
+    CATALOG_DIMS
+};
+
+/**
+ * @brief One row of the courses table. Strings are offsets into the
+ * catalog string pool so the record holds no pointers.
+ */
+typedef struct {
+    uint32_t id;
+    uint32_t code;
+    uint32_t course;
+    uint32_t subjectMap;
+    uint16_t credits;
+    uint16_t value[CATALOG_DIMS]; // value id of the row in each dimension
+} CatalogCourse;
+
+/**
+ * @brief Entry of the typeahead index: a lowercased course code or name
+ */
+typedef struct {
+    uint32_t key;    // offset into the suggestion key pool
+    uint32_t course; // catalog index
+} CatalogSuggestion;
+
+/**
+ * @brief Identity of the database file a catalog was loaded from. The
+ * file fields change on any write, the fingerprint only when the catalog
+ * tables do, not when the selected table is written.
+ */
+typedef struct {
+    int64_t inode;
+    int64_t size;
+    int64_t mtime;        // nanoseconds
+    uint64_t fingerprint; // hash of the rows of the catalog tables
+} CatalogSource;
+
+/**
+ * @brief In-memory copy of the courses catalog with one bitset per
+ * distinct filter value, so filters resolve with word-wide AND/OR.
+ */
+typedef struct {
+    CatalogSource source;
+
+    uint32_t courseCount;
+    CatalogCourse *courses;
+
+    uint32_t stringsSize;
+    char *strings; // interned, '\0' separated
+
+    uint32_t bitsetWords; // uint64_t words per course bitset
+    uint32_t valueCount[CATALOG_DIMS];
+    uint32_t *values[CATALOG_DIMS];  // string offset of each value
+    uint64_t *bitsets[CATALOG_DIMS]; // valueCount * bitsetWords words
+
+    // filter options offered by the search forms: the values of the exact
+    // dimensions, the comma separated parts of the others
+    uint32_t optionCount[CATALOG_DIMS];
+    uint32_t *options[CATALOG_DIMS];    // string offset of each option, sorted ignoring case
+    uint64_t *optionBits[CATALOG_DIMS]; // optionCount * bitsetWords words: courses listing the option
+
+    uint32_t suggestionCount;
+    CatalogSuggestion *suggestions; // codes and names, sorted by key
+    uint32_t suggestKeysSize;
+    char *suggestKeys;
+
+    uint32_t vectorDims; // floats per course vector
+    float *vectors;      // courseCount rows of L2-normalized TF-IDF weights
+
+    void *mapping;      // snapshot the arrays point into, NULL when they are allocated
+    size_t mappingSize;
+} Catalog;
+
+/**
+ * @brief Filter terms of a query; terms of one dimension are OR-ed,
+ * dimensions are AND-ed, an empty dimension matches everything.
+ */
+typedef struct {
+    const char *terms[CATALOG_DIMS][CATALOG_MAX_TERMS];
+    int termCount[CATALOG_DIMS];
+} CatalogFilter;
+
+/**
+ * @brief Loads courses (with their subjectmap links) from the database
+ * @param cat catalog to fill
+ * @param dbPath path of the sqlite database
+ * @return 0 on success, -1 on failure
+ */
+int catalogLoad(Catalog *cat, const char *dbPath);
+
+/**
+ * @brief Reads the file fields of the identity of the database at dbPath,
+ * leaving the fingerprint untouched
+ * @return 0 on success, -1 if the file cannot be read
+ */
+int catalogSourceStat(const char *dbPath, CatalogSource *source);
+
+/**
+ * @brief Hashes the rows of courses, subjectmap, faculties and
+ * universities, everything the catalog and the pages are built from
+ * @return 0 on success, -1 if the database cannot be read
+ */
+int catalogFingerprint(const char *dbPath, uint64_t *fingerprint);
+
+/**
+ * @brief Releases memory owned by the catalog
+ */
+void catalogFree(Catalog *cat);
+
+/**
+ * @brief Returns the string stored at offset off of the string pool
+ */
+static inline const char *catalogString(const Catalog *cat, uint32_t off)
+{
+    return cat->strings + off;
+}
+
+/**
+ * @brief Returns the index of the course with the given id or -1
+ */
+int catalogFind(const Catalog *cat, uint32_t id);
+
+/**
+ * @brief Adds a term to the filter, ignoring terms above CATALOG_MAX_TERMS
+ */
+void catalogFilterAdd(CatalogFilter *filter, int dim, const char *term);
+
+/**
+ * @brief Sets bits of courses whose value in dim matches term
+ * @param bits bitset of cat->bitsetWords words, OR-ed into
+ */
+void catalogMatchTerm(const Catalog *cat, int dim, const char *term, uint64_t *bits);
+
+/**
+ * @brief Computes the bitset of courses matching every dimension of the
+ * filter, skipping dimension skipDim (pass -1 to use all of them)
+ * @param bits bitset of cat->bitsetWords words, overwritten
+ * @param scratch bitset of cat->bitsetWords words used as work space
+ */
+void catalogFilterBits(const Catalog *cat, const CatalogFilter *filter, int skipDim,
+                       uint64_t *bits, uint64_t *scratch);
+
+/**
+ * @brief Counts, for every dimension and each of its options, the courses
+ * the search would return with the option as the only term of that
+ * dimension and the other dimensions filtered as given. Options that no
+ * course of those results lists get 0, so facets only show options that
+ * appear in the results.
+ * @param nameTerm substring the course name must contain, or NULL
+ * @param counts counters per dimension and option id, overwritten
+ * @return number of courses matching the whole filter
+ */
+uint32_t catalogFacetCounts(const Catalog *cat, const CatalogFilter *filter, const char *nameTerm,
+                            uint32_t counts[CATALOG_DIMS][CATALOG_MAX_VALUES]);
+
+/**
+ * @brief Splits the next option off a stored filter value, which may list
+ * several separated by commas, e.g. "W,S" or "Autumn, Spring". Spaces and
+ * punctuation around the option are dropped.
+ * @param text position in the value, advanced past the option
+ * @param len set to the length of the option, 0 for an empty one
+ * @return start of the option, or NULL at the end of the value
+ */
+const char *catalogNextOption(const char **text, size_t *len);
+
+/**
+ * @brief Finds courses whose code or name starts with prefix, ignoring case
+ * @param allowed bitset of courses that may be returned, or NULL for all
+ * @param out catalog indexes of the matches in key order, no duplicates
+ * @param k size of out
+ * @return number of matches written to out
+ */
+int catalogSuggest(const Catalog *cat, const char *prefix, const uint64_t *allowed, uint32_t *out, int k);
+
+static inline int bitsetTest(const uint64_t *bits, uint32_t i)
+{
+    return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+static inline void bitsetSet(uint64_t *bits, uint32_t i)
+{
+    bits[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+
+#endif
@@ -0,0 +1,903 @@
+#define _GNU_SOURCE // accept4, memmem, strcasestr
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "eventloop.h"
+#include "server.h"
+#include "timerwheel.h"
+#include "uring.h"
+
+#define MAX_EVENTS 64
+#define TICK_MS 100 // timer wheel resolution
+#define LINGER_TIMEOUT 2 // seconds a closing connection drains unread input
+
+#define URING_ENTRIES 256
+#define URING_BUFFERS 512 // receive buffers, power of two
+#define URING_BUFFER_SIZE 4096
+
+enum { CONN_READING, CONN_BODY, CONN_QUEUED, CONN_WRITING, CONN_LINGERING, CONN_CLOSED };
+
+// operation of an io_uring completion, kept in the low bits of user_data
+enum { OP_ACCEPT, OP_RECV, OP_SEND, OP_CLOSE, OP_IGNORE, OP_MASK = 7 };
+
+typedef struct Connection {
+    int fd;
+    uint32_t ip;
+    int state;
+    int served;    // requests answered on this connection
+    int keepAlive; // the client allows another request after this one
+    Timer timer;   // deadline of the current state
+    char in[REQUEST_SIZE];
+    size_t inLen;
+    char *head; // request head being handled
+    long bodyLeft;
+    char *out;
+    size_t outLen;
+    size_t outSent;
+    int inflight;    // io_uring: receive, send and close still running
+    int receiving;   // io_uring: multishot receive armed
+    int sending;     // io_uring: send running
+    int closeQueued; // io_uring: cancel and close queued
+    struct Connection *next; // next in its serve queue or the closed queue
+} Connection;
+
+typedef struct {
+    Connection *head;
+    Connection *tail;
+} Queue;
+
+static const AdmissionConfig *limits;
+static int epfd;
+static Uring *ring; // set when the io_uring backend runs
+static UringBuffers buffers;
+static int openConnections;
+static int queuedQueries;
+static Queue staticQueue; // static files and typeahead, served first
+static Queue queryQueue;
+static Queue closedQueue; // freed at the end of the round
+static TimerWheel wheel;
+
+static const char overloaded[] = "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\n"
+                                 "Content-Length: 0\r\nConnection: close\r\n\r\n";
+
+static void processInput(Connection *c);
+static void writeConnection(Connection *c);
+static void drainConnection(Connection *c);
+static void uringReceive(Connection *c);
+static void uringSend(Connection *c);
+static void uringClose(Connection *c);
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t nowTicks(void)
+{
+    return (uint64_t)(now() * 1000 / TICK_MS);
+}
+
+static void push(Queue *q, Connection *c)
+{
+    c->next = NULL;
+    if (q->tail)
+    {
+        q->tail->next = c;
+    }
+    else
+    {
+        q->head = c;
+    }
+    q->tail = c;
+}
+
+static Connection *pop(Queue *q)
+{
+    Connection *c = q->head;
+    q->head = c->next;
+    if (q->head == NULL)
+    {
+        q->tail = NULL;
+    }
+    return c;
+}
+
+/**
+ * @brief Closes the connection; its memory is released at the end of the
+ * round, or once io_uring has finished every operation on it
+ */
+static void closeConnection(Connection *c)
+{
+    if (c->state == CONN_CLOSED)
+    {
+        return;
+    }
+    timerCancel(&wheel, &c->timer);
+    c->state = CONN_CLOSED;
+    if (ring)
+    {
+        uringClose(c);
+        return;
+    }
+    close(c->fd);
+    push(&closedQueue, c);
+}
+
+static void freeClosed(void)
+{
+    while (closedQueue.head)
+    {
+        Connection *c = pop(&closedQueue);
+        free(c->head);
+        free(c->out);
+        free(c);
+        openConnections--;
+    }
+}
+
+static void setDeadline(Connection *c, double seconds)
+{
+    timerSchedule(&wheel, &c->timer, wheel.now + (uint64_t)(seconds * 1000 / TICK_MS) + 1);
+}
+
+/**
+ * @brief Runs when a connection misses its header, body, write or
+ * keep-alive deadline
+ */
+static void connectionTimeout(Timer *timer)
+{
+    Connection *c = (Connection *)((char *)timer - offsetof(Connection, timer));
+    closeConnection(c);
+}
+
+static Connection *openConnection(int fd, uint32_t ip)
+{
+    Connection *c = calloc(1, sizeof(Connection));
+    if (c == NULL)
+    {
+        fprintf(stderr, "Not enough memory!\n");
+        close(fd);
+        return NULL;
+    }
+    c->fd = fd;
+    c->ip = ip;
+    c->state = CONN_READING;
+    c->timer.callback = connectionTimeout;
+    openConnections++;
+    setDeadline(c, limits->headerTimeout);
+    return c;
+}
+
+/**
+ * @brief Waits for the next request on a kept-alive connection
+ */
+static void nextRequest(Connection *c)
+{
+    free(c->out);
+    c->out = NULL;
+    c->served++;
+    c->state = CONN_READING;
+
+    if (ring)
+    {
+        if (!c->receiving)
+        {
+            uringReceive(c);
+        }
+    }
+    else
+    {
+        struct epoll_event ev = {.events = EPOLLIN | EPOLLET, .data.ptr = c};
+        epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    }
+
+    // an idle client gets the keep-alive timeout, a pipelined one the header timeout
+    setDeadline(c, c->inLen ? limits->headerTimeout : limits->idleTimeout);
+    processInput(c);
+}
+
+/**
+ * @brief Ends a connection after its last response. Closing a socket with
+ * unread input resets it, which can discard the response before the
+ * client reads it, so the write side is shut down and input is dropped
+ * until the client closes or LINGER_TIMEOUT passes.
+ */
+static void lingerConnection(Connection *c)
+{
+    c->state = CONN_LINGERING;
+    c->inLen = 0;
+    setDeadline(c, LINGER_TIMEOUT);
+    if (ring)
+    {
+        // the shutdown was linked behind the send
+        if (!c->receiving)
+        {
+            uringReceive(c);
+        }
+        return;
+    }
+    shutdown(c->fd, SHUT_WR);
+    struct epoll_event ev = {.events = EPOLLIN | EPOLLET, .data.ptr = c};
+    epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    drainConnection(c);
+}
+
+static void startWrite(Connection *c, char *out, size_t len)
+{
+    c->state = CONN_WRITING;
+    c->out = out;
+    c->outLen = len;
+    c->outSent = 0;
+
+    // only a response with a known length can be followed by another one
+    char *end = memmem(out, len, "\r\n\r\n", 4);
+    c->keepAlive = c->keepAlive && end && memmem(out, end - out, "Content-Length:", 15);
+
+    setDeadline(c, limits->writeTimeout);
+    if (ring)
+    {
+        uringSend(c);
+    }
+    else
+    {
+        writeConnection(c);
+    }
+}
+
+static void refuse(Connection *c, int retryAfter)
+{
+    char *out = malloc(160);
+    if (out == NULL)
+    {
+        closeConnection(c);
+        return;
+    }
+    size_t len = snprintf(out, 160,
+                          "HTTP/1.1 503 Service Unavailable\r\nRetry-After: %d\r\n"
+                          "Content-Length: 0\r\nConnection: close\r\n\r\n",
+                          retryAfter);
+    c->keepAlive = 0;
+    startWrite(c, out, len);
+}
+
+static void requestComplete(Connection *c)
+{
+    int retryAfter;
+
+    if (isQueryRequest(c->head) && !admissionAllow(limits, c->ip, now(), &retryAfter))
+    {
+        refuse(c, retryAfter);
+        return;
+    }
+
+    // the server's own queueing time is not charged to the client
+    timerCancel(&wheel, &c->timer);
+    c->state = CONN_QUEUED;
+    if (!isQueryRequest(c->head))
+    {
+        push(&staticQueue, c);
+    }
+    else if (queuedQueries < limits->maxQueries)
+    {
+        push(&queryQueue, c);
+        queuedQueries++;
+    }
+    else
+    {
+        refuse(c, 1);
+    }
+}
+
+/**
+ * @brief Drops the first n bytes of the input buffer
+ */
+static void consume(Connection *c, size_t n)
+{
+    memmove(c->in, c->in + n, c->inLen - n);
+    c->inLen -= n;
+}
+
+/**
+ * @brief Takes the request head of headLen bytes off the input buffer
+ */
+static void headComplete(Connection *c, size_t headLen)
+{
+    free(c->head);
+    c->head = strndup(c->in, headLen);
+    consume(c, headLen);
+    if (c->head == NULL)
+    {
+        closeConnection(c);
+        return;
+    }
+
+    // HTTP/1.1 keeps the connection unless told otherwise, HTTP/1.0 only when asked
+    char *line = strpbrk(c->head, "\r\n");
+    int http11 = line && line - c->head >= 8 && strncmp(line - 8, "HTTP/1.1", 8) == 0;
+    c->keepAlive = strcasestr(c->head, "\nConnection: close") ? 0 :
+                   http11 || strcasestr(c->head, "\nConnection: keep-alive");
+
+    // a body is read and dropped, so the next request starts at the right byte
+    char *length = strcasestr(c->head, "\nContent-Length:");
+    c->bodyLeft = length ? atol(length + 16) : 0;
+    if (c->bodyLeft > 0)
+    {
+        c->state = CONN_BODY;
+        setDeadline(c, limits->bodyTimeout);
+        processInput(c);
+        return;
+    }
+    requestComplete(c);
+}
+
+/**
+ * @brief Advances the connection through whatever input is buffered
+ */
+static void processInput(Connection *c)
+{
+    if (c->state == CONN_BODY)
+    {
+        size_t take = (size_t)c->bodyLeft < c->inLen ? (size_t)c->bodyLeft : c->inLen;
+        consume(c, take);
+        c->bodyLeft -= take;
+        if (c->bodyLeft == 0)
+        {
+            requestComplete(c);
+        }
+        return;
+    }
+    if (c->state != CONN_READING || c->inLen == 0)
+    {
+        return;
+    }
+
+    char *end = memmem(c->in, c->inLen, "\r\n\r\n", 4);
+    size_t headLen = end ? (size_t)(end - c->in) + 4 : 0;
+    end = memmem(c->in, c->inLen, "\n\n", 2);
+    if (end && (headLen == 0 || (size_t)(end - c->in) + 2 < headLen))
+    {
+        headLen = (end - c->in) + 2;
+    }
+    if (headLen == 0 && c->inLen == REQUEST_SIZE - 1)
+    {
+        // oversized head: answer what fits, then close
+        headLen = c->inLen;
+    }
+    if (headLen)
+    {
+        headComplete(c, headLen);
+        if (headLen == REQUEST_SIZE - 1 && c->state == CONN_QUEUED)
+        {
+            c->keepAlive = 0;
+        }
+    }
+}
+
+/**
+ * @brief Accounts for n bytes the backend appended to the input buffer
+ */
+static void received(Connection *c, size_t n)
+{
+    // the first byte after an idle keep-alive wait starts the header deadline
+    if (c->state == CONN_READING && c->inLen == 0 && c->served > 0)
+    {
+        setDeadline(c, limits->headerTimeout);
+    }
+    c->inLen += n;
+    processInput(c);
+}
+
+/**
+ * @brief Handles the end of the client's input
+ */
+static void peerClosed(Connection *c)
+{
+    // a peer that closes after a partial head still gets an answer
+    if (c->state == CONN_READING && c->inLen > 0)
+    {
+        headComplete(c, c->inLen);
+    }
+    if (c->state == CONN_QUEUED || c->state == CONN_WRITING)
+    {
+        c->keepAlive = 0;
+        return;
+    }
+    closeConnection(c);
+}
+
+static void serveConnection(Connection *c)
+{
+    char *out = NULL;
+    size_t len = 0;
+    handleRequest(c->head, &out, &len);
+    free(c->head);
+    c->head = NULL;
+    startWrite(c, out, len);
+}
+
+/**
+ * @brief How long the loop may wait for I/O: until the next busy wheel
+ * slot, not at all while requests wait
+ */
+static int waitTimeout(void)
+{
+    long idle = timerIdleTicks(&wheel);
+    if (staticQueue.head || queryQueue.head)
+    {
+        return 0;
+    }
+    if (idle < 0)
+    {
+        return -1;
+    }
+    double wake = (double)(wheel.now + idle) * TICK_MS - now() * 1000;
+    return wake > 0 ? (int)wake + 1 : 0;
+}
+
+static void serveQueues(void)
+{
+    // static files first; one search per round so new events get in between
+    while (staticQueue.head)
+    {
+        serveConnection(pop(&staticQueue));
+    }
+    if (queryQueue.head)
+    {
+        queuedQueries--;
+        serveConnection(pop(&queryQueue));
+    }
+}
+
+// epoll backend: non-blocking sockets, read and send until EAGAIN
+
+static void writeConnection(Connection *c)
+{
+    while (c->outSent < c->outLen)
+    {
+        ssize_t n = send(c->fd, c->out + c->outSent, c->outLen - c->outSent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EAGAIN)
+        {
+            // the rest goes out when the socket drains
+            struct epoll_event ev = {.events = EPOLLOUT | EPOLLET, .data.ptr = c};
+            epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+            return;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            closeConnection(c);
+            return;
+        }
+        c->outSent += n;
+    }
+
+    if (c->keepAlive)
+    {
+        nextRequest(c);
+    }
+    else
+    {
+        lingerConnection(c);
+    }
+}
+
+/**
+ * @brief Reads and drops input of a lingering connection until the client
+ * closes
+ */
+static void drainConnection(Connection *c)
+{
+    while (1)
+    {
+        ssize_t n = read(c->fd, c->in, REQUEST_SIZE);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0 && errno == EAGAIN)
+        {
+            return;
+        }
+        if (n <= 0)
+        {
+            closeConnection(c);
+            return;
+        }
+    }
+}
+
+static void readConnection(Connection *c)
+{
+    while (c->state == CONN_READING || c->state == CONN_BODY)
+    {
+        ssize_t n = read(c->fd, c->in + c->inLen, REQUEST_SIZE - 1 - c->inLen);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0 && errno == EAGAIN)
+        {
+            return;
+        }
+        if (n <= 0)
+        {
+            peerClosed(c);
+            return;
+        }
+        received(c, n);
+    }
+}
+
+static void acceptConnections(int listenSocket)
+{
+    while (1)
+    {
+        struct sockaddr_in addr;
+        socklen_t addrLen = sizeof(addr);
+        int fd = accept4(listenSocket, (struct sockaddr *)&addr, &addrLen, SOCK_NONBLOCK);
+        if (fd < 0)
+        {
+            // EAGAIN once the accept queue is drained
+            return;
+        }
+
+        // fail fast instead of letting the client time out; the refused
+        // connection lingers like any other unless twice the limit is open
+        int refused = openConnections >= limits->maxConnections;
+        if (openConnections >= 2 * limits->maxConnections)
+        {
+            send(fd, overloaded, sizeof(overloaded) - 1, MSG_NOSIGNAL);
+            close(fd);
+            continue;
+        }
+
+        Connection *c = openConnection(fd, addr.sin_family == AF_INET ? addr.sin_addr.s_addr : 0);
+        if (c == NULL)
+        {
+            continue;
+        }
+        struct epoll_event ev = {.events = EPOLLIN | EPOLLET, .data.ptr = c};
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            closeConnection(c);
+            continue;
+        }
+        if (refused)
+        {
+            refuse(c, 1);
+            continue;
+        }
+        readConnection(c);
+    }
+}
+
+static int serveEpoll(int listenSocket)
+{
+    struct epoll_event events[MAX_EVENTS];
+
+    fcntl(listenSocket, F_SETFL, fcntl(listenSocket, F_GETFL) | O_NONBLOCK);
+    epfd = epoll_create1(0);
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+    if (epfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, listenSocket, &ev) < 0)
+    {
+        perror("epoll");
+        return 1;
+    }
+
+    while (1)
+    {
+        int n = epoll_wait(epfd, events, MAX_EVENTS, waitTimeout());
+        if (n < 0 && errno != EINTR)
+        {
+            perror("epoll_wait");
+            return 1;
+        }
+        timerAdvance(&wheel, nowTicks());
+
+        for (int i = 0; i < n; i++)
+        {
+            Connection *c = events[i].data.ptr;
+            if (c == NULL)
+            {
+                acceptConnections(listenSocket);
+            }
+            else if (c->state == CONN_READING || c->state == CONN_BODY)
+            {
+                readConnection(c);
+            }
+            else if (c->state == CONN_WRITING)
+            {
+                writeConnection(c);
+            }
+            else if (c->state == CONN_LINGERING)
+            {
+                drainConnection(c);
+            }
+        }
+
+        serveQueues();
+        freeClosed();
+    }
+}
+
+// io_uring backend: one multishot accept, a multishot receive per
+// connection into the provided buffer ring, and a send per response with
+// the close linked behind it when the connection ends
+
+static uint64_t userData(Connection *c, int op)
+{
+    return (uint64_t)(uintptr_t)c | op;
+}
+
+static void uringAccept(int listenSocket)
+{
+    struct io_uring_sqe *sqe = uringPrep(ring, IORING_OP_ACCEPT, listenSocket, NULL, 0,
+                                         userData(NULL, OP_ACCEPT));
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+}
+
+static void uringReceive(Connection *c)
+{
+    struct io_uring_sqe *sqe = uringPrep(ring, IORING_OP_RECV, c->fd, NULL, 0, userData(c, OP_RECV));
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buffers.group;
+    c->receiving = 1;
+    c->inflight++;
+}
+
+/**
+ * @brief Queues cancelling everything still running on the socket and
+ * closing it; the close runs even if there was nothing to cancel
+ */
+static void uringQueueClose(Connection *c)
+{
+    struct io_uring_sqe *sqe = uringPrep(ring, IORING_OP_ASYNC_CANCEL, c->fd, NULL, 0,
+                                         userData(NULL, OP_IGNORE));
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->flags = IOSQE_IO_HARDLINK;
+    uringPrep(ring, IORING_OP_CLOSE, c->fd, NULL, 0, userData(c, OP_CLOSE));
+    c->closeQueued = 1;
+    c->inflight++;
+}
+
+static void uringSend(Connection *c)
+{
+    // send and shutdown must reach the kernel as one chain
+    uringReserve(ring, 2);
+    struct io_uring_sqe *sqe = uringPrep(ring, IORING_OP_SEND, c->fd, c->out + c->outSent,
+                                         c->outLen - c->outSent, userData(c, OP_SEND));
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    c->sending = 1;
+    c->inflight++;
+    if (!c->keepAlive)
+    {
+        // the last response: stop sending once it is out, see lingerConnection
+        sqe->flags = IOSQE_IO_HARDLINK;
+        uringPrep(ring, IORING_OP_SHUTDOWN, c->fd, NULL, SHUT_WR, userData(NULL, OP_IGNORE));
+    }
+}
+
+static void uringClose(Connection *c)
+{
+    if (!c->closeQueued)
+    {
+        uringQueueClose(c);
+    }
+}
+
+/**
+ * @brief Copies received bytes into the input buffer
+ */
+static void uringReceived(Connection *c, const char *data, size_t n)
+{
+    while (n > 0 && (c->state == CONN_READING || c->state == CONN_BODY))
+    {
+        size_t room = REQUEST_SIZE - 1 - c->inLen;
+        size_t take = n < room ? n : room;
+        memcpy(c->in + c->inLen, data, take);
+        data += take;
+        n -= take;
+        received(c, take);
+    }
+    if (n > 0 && c->state != CONN_CLOSED && c->state != CONN_LINGERING)
+    {
+        // pipelined while a response is pending: keep what fits
+        size_t room = REQUEST_SIZE - 1 - c->inLen;
+        size_t take = n < room ? n : room;
+        memcpy(c->in + c->inLen, data, take);
+        c->inLen += take;
+        if (take < n)
+        {
+            c->keepAlive = 0;
+        }
+    }
+}
+
+static void uringAccepted(int fd)
+{
+    // as in acceptConnections
+    int refused = openConnections >= limits->maxConnections;
+    if (openConnections >= 2 * limits->maxConnections)
+    {
+        uringReserve(ring, 2);
+        struct io_uring_sqe *sqe = uringPrep(ring, IORING_OP_SEND, fd, overloaded, sizeof(overloaded) - 1,
+                                             userData(NULL, OP_IGNORE));
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->flags = IOSQE_IO_HARDLINK;
+        uringPrep(ring, IORING_OP_CLOSE, fd, NULL, 0, userData(NULL, OP_IGNORE));
+        return;
+    }
+
+    // multishot accept returns no address
+    struct sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+    uint32_t ip = 0;
+    if (getpeername(fd, (struct sockaddr *)&addr, &addrLen) == 0 && addr.sin_family == AF_INET)
+    {
+        ip = addr.sin_addr.s_addr;
+    }
+    Connection *c = openConnection(fd, ip);
+    if (c && refused)
+    {
+        refuse(c, 1);
+    }
+    else if (c)
+    {
+        uringReceive(c);
+    }
+}
+
+static int uringComplete(int listenSocket, struct io_uring_cqe *cqe)
+{
+    Connection *c = (Connection *)(uintptr_t)(cqe->user_data & ~(uint64_t)OP_MASK);
+    int op = cqe->user_data & OP_MASK;
+    int more = cqe->flags & IORING_CQE_F_MORE;
+
+    switch (op)
+    {
+    case OP_ACCEPT:
+        if (cqe->res >= 0)
+        {
+            uringAccepted(cqe->res);
+        }
+        if (!more)
+        {
+            if (cqe->res < 0 && cqe->res != -EINTR && cqe->res != -ECONNABORTED && cqe->res != -EMFILE &&
+                cqe->res != -ENFILE && cqe->res != -ENOBUFS && cqe->res != -ENOMEM)
+            {
+                fprintf(stderr, "io_uring accept: %s\n", strerror(-cqe->res));
+                return -1;
+            }
+            uringAccept(listenSocket);
+        }
+        return 0;
+
+    case OP_RECV:
+        if (cqe->flags & IORING_CQE_F_BUFFER)
+        {
+            uint16_t id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+            if (cqe->res > 0)
+            {
+                uringReceived(c, uringBuffer(&buffers, id), cqe->res);
+            }
+            uringBufferRecycle(&buffers, id);
+        }
+        if (!more)
+        {
+            c->receiving = 0;
+            c->inflight--;
+            if (cqe->res > 0 || cqe->res == -ENOBUFS)
+            {
+                // stopped without an error, e.g. when buffers ran out
+                if (c->state != CONN_CLOSED)
+                {
+                    uringReceive(c);
+                }
+            }
+            else if (cqe->res != -ECANCELED)
+            {
+                peerClosed(c);
+            }
+        }
+        break;
+
+    case OP_SEND:
+        c->sending = 0;
+        c->inflight--;
+        if (c->state != CONN_WRITING)
+        {
+            break;
+        }
+        if (cqe->res != (int)(c->outLen - c->outSent))
+        {
+            closeConnection(c);
+        }
+        else if (c->keepAlive)
+        {
+            nextRequest(c);
+        }
+        else
+        {
+            lingerConnection(c);
+        }
+        break;
+
+    case OP_CLOSE:
+        c->inflight--;
+        break;
+
+    default:
+        return 0;
+    }
+
+    if (c->state == CONN_CLOSED && c->inflight == 0)
+    {
+        push(&closedQueue, c);
+    }
+    return 0;
+}
+
+static int serveUring(int listenSocket)
+{
+    Uring uring;
+    if (uringInit(&uring, URING_ENTRIES) < 0 ||
+        uringBuffersInit(&uring, &buffers, 0, URING_BUFFERS, URING_BUFFER_SIZE) < 0)
+    {
+        fprintf(stderr, "io_uring unavailable (%s), using epoll\n", strerror(errno));
+        if (uring.fd >= 0)
+        {
+            uringFree(&uring);
+        }
+        return serveEpoll(listenSocket);
+    }
+    ring = &uring;
+    uringAccept(listenSocket);
+
+    while (1)
+    {
+        if (uringSubmit(ring, waitTimeout()) < 0)
+        {
+            perror("io_uring_enter");
+            return 1;
+        }
+        timerAdvance(&wheel, nowTicks());
+
+        struct io_uring_cqe *cqe;
+        while ((cqe = uringPeek(ring)) != NULL)
+        {
+            int result = uringComplete(listenSocket, cqe);
+            uringSeen(ring);
+            if (result < 0)
+            {
+                return 1;
+            }
+        }
+
+        serveQueues();
+        freeClosed();
+    }
+}
+
+int serveEvents(int listenSocket, const AdmissionConfig *config, int backend)
+{
+    limits = config;
+    timerWheelInit(&wheel, nowTicks());
+    return backend == BACKEND_URING ? serveUring(listenSocket) : serveEpoll(listenSocket);
+}
@@ -0,0 +1,26 @@
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include "admission.h"
+
+/**
+ * @brief I/O backends of the request loop
+ */
+enum
+{
+    BACKEND_EPOLL, // non-blocking sockets with readiness events
+    BACKEND_URING  // io_uring submissions, falls back to epoll if unavailable
+};
+
+/**
+ * @brief Serves clients of listenSocket until the process is stopped.
+ * Requests are read without blocking and handled one at a time: static
+ * files and typeahead before searches. Connections above maxConnections, searches above
+ * maxQueries and searches of clients over their rate get an immediate 503
+ * with Retry-After.
+ * @param backend BACKEND_EPOLL or BACKEND_URING
+ * @return 1 if the loop could not be set up
+ */
+int serveEvents(int listenSocket, const AdmissionConfig *config, int backend);
+
+#endif
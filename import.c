@@ -0,0 +1,908 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h> // strcasecmp
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sqlite3.h>
+
+#include "import.h"
+
+#define IMPORT_BATCH 50000    // rows per transaction
+#define IMPORT_MAX_FIELDS 64  // fields of one record
+#define IMPORT_LOCK_TIMEOUT_MS 5000 // wait for the server to finish saving a selection
+
+typedef struct {
+    const char *name;
+    const char *create;
+    const char *columns[8];
+    int columnCount;
+} ImportTable;
+
+enum { T_COURSES, T_SUBJECTMAP, T_FACULTIES, T_UNIVERSITIES, T_SELECTED, TABLE_COUNT };
+
+// schemas of euroteq.db
+static const ImportTable tables[TABLE_COUNT] = {
+    {"courses",
+     "CREATE TABLE \"courses\" (\"id\" INTEGER UNIQUE, \"Code\" TEXT, \"Course\" TEXT, \"Semester\" TEXT, "
+     "\"Credits\" INTEGER, \"Faculty\" TEXT, \"Studylevel\" TEXT, \"University\" TEXT)",
+     {"id", "Code", "Course", "Semester", "Credits", "Faculty", "Studylevel", "University"}, 8},
+    {"subjectmap",
+     "CREATE TABLE \"subjectmap\" (\"id\" INTEGER, \"Code\" TEXT, \"Course\" TEXT, \"SubjectMap\" TEXT)",
+     {"id", "Code", "Course", "SubjectMap"}, 4},
+    {"faculties",
+     "CREATE TABLE \"faculties\" (\"Faculty\" TEXT, \"FullName\" TEXT, \"Website\" TEXT, \"University\" TEXT)",
+     {"Faculty", "FullName", "Website", "University"}, 4},
+    {"universities",
+     "CREATE TABLE \"universities\" (\"University\" TEXT, \"FullName\" TEXT, \"Website\" TEXT, \"Info\" TEXT)",
+     {"University", "FullName", "Website", "Info"}, 4},
+    {"selected",
+     "CREATE TABLE \"selected\" (\"id\" INTEGER UNIQUE, \"Code\" TEXT, \"Course\" TEXT, \"Semester\" TEXT, "
+     "\"Credits\" INTEGER, \"Faculty\" TEXT, \"Studylevel\" TEXT, \"University\" TEXT)",
+     {"id", "Code", "Course", "Semester", "Credits", "Faculty", "Studylevel", "University"}, 8},
+};
+
+// indexes used by the searches, built once the rows are in
+static const char *indexes[] = {
+    "CREATE INDEX \"courses_University\" ON \"courses\" (\"University\")",
+    "CREATE INDEX \"courses_Faculty\" ON \"courses\" (\"Faculty\")",
+    "CREATE INDEX \"subjectmap_id\" ON \"subjectmap\" (\"id\")",
+};
+
+/**
+ * @brief Streaming reader of CSV or JSON records. Field strings live in
+ * buf and stay valid until the next record is read.
+ */
+typedef struct {
+    FILE *fp;
+    const char *path;
+    int json;
+    long line;
+
+    char *buf;
+    size_t len, cap;
+
+    int count;
+    size_t nameOff[IMPORT_MAX_FIELDS];
+    size_t valueOff[IMPORT_MAX_FIELDS]; // (size_t)-1 for NULL
+
+    // CSV header
+    char *header[IMPORT_MAX_FIELDS];
+    int headerCount;
+} Reader;
+
+static int readerPut(Reader *r, char c)
+{
+    if (r->len == r->cap)
+    {
+        size_t cap = r->cap ? r->cap * 2 : 4096;
+        char *buf = realloc(r->buf, cap);
+        if (buf == NULL)
+        {
+            fprintf(stderr, "Not enough memory!\n");
+            return -1;
+        }
+        r->buf = buf;
+        r->cap = cap;
+    }
+    r->buf[r->len++] = c;
+    return 0;
+}
+
+static int readerError(Reader *r, const char *msg)
+{
+    fprintf(stderr, "Error: %s:%ld: %s\n", r->path, r->line, msg);
+    return -1;
+}
+
+/**
+ * @brief Reads one CSV record, fields go to valueOff
+ * @return 1 on a record, 0 at end of file, -1 on error
+ */
+static int readCsvRecord(Reader *r)
+{
+    int c = getc_unlocked(r->fp);
+
+    // skip blank lines
+    while (c == '\n' || c == '\r')
+    {
+        if (c == '\n')
+        {
+            r->line++;
+        }
+        c = getc_unlocked(r->fp);
+    }
+    if (c == EOF)
+    {
+        return 0;
+    }
+
+    r->len = 0;
+    r->count = 0;
+    while (1)
+    {
+        if (r->count == IMPORT_MAX_FIELDS)
+        {
+            return readerError(r, "too many fields");
+        }
+        size_t start = r->len;
+        int quoted = 0;
+
+        if (c == '"')
+        {
+            quoted = 1;
+            while (1)
+            {
+                c = getc_unlocked(r->fp);
+                if (c == EOF)
+                {
+                    return readerError(r, "unterminated quoted field");
+                }
+                if (c == '"')
+                {
+                    c = getc_unlocked(r->fp);
+                    if (c != '"')
+                    {
+                        break;
+                    }
+                }
+                if (c == '\n')
+                {
+                    r->line++;
+                }
+                if (readerPut(r, c) < 0)
+                {
+                    return -1;
+                }
+            }
+        }
+        while (c != ',' && c != '\n' && c != EOF)
+        {
+            if (c != '\r' && readerPut(r, c) < 0)
+            {
+                return -1;
+            }
+            c = getc_unlocked(r->fp);
+        }
+        if (readerPut(r, '\0') < 0)
+        {
+            return -1;
+        }
+        // an empty unquoted field is NULL, "" is an empty string
+        r->valueOff[r->count++] = (!quoted && r->len == start + 1) ? (size_t)-1 : start;
+
+        if (c != ',')
+        {
+            if (c == '\n')
+            {
+                r->line++;
+            }
+            return 1;
+        }
+        c = getc_unlocked(r->fp);
+    }
+}
+
+static int skipSpace(Reader *r)
+{
+    int c;
+    do
+    {
+        c = getc_unlocked(r->fp);
+        if (c == '\n')
+        {
+            r->line++;
+        }
+    } while (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+    return c;
+}
+
+static int putUtf8(Reader *r, unsigned long cp)
+{
+    if (cp < 0x80)
+    {
+        return readerPut(r, cp);
+    }
+    if (cp < 0x800)
+    {
+        return readerPut(r, 0xC0 | (cp >> 6)) | readerPut(r, 0x80 | (cp & 0x3F));
+    }
+    if (cp < 0x10000)
+    {
+        return readerPut(r, 0xE0 | (cp >> 12)) | readerPut(r, 0x80 | ((cp >> 6) & 0x3F)) |
+               readerPut(r, 0x80 | (cp & 0x3F));
+    }
+    return readerPut(r, 0xF0 | (cp >> 18)) | readerPut(r, 0x80 | ((cp >> 12) & 0x3F)) |
+           readerPut(r, 0x80 | ((cp >> 6) & 0x3F)) | readerPut(r, 0x80 | (cp & 0x3F));
+}
+
+static long readHex4(Reader *r)
+{
+    char hex[5] = "";
+    for (int i = 0; i < 4; i++)
+    {
+        int c = getc_unlocked(r->fp);
+        if (c == EOF || !strchr("0123456789abcdefABCDEF", c))
+        {
+            return -1;
+        }
+        hex[i] = c;
+    }
+    return strtol(hex, NULL, 16);
+}
+
+/**
+ * @brief Reads the rest of a JSON string after its opening quote into buf
+ */
+static int readJsonString(Reader *r)
+{
+    while (1)
+    {
+        int c = getc_unlocked(r->fp);
+        if (c == EOF || c == '\n')
+        {
+            return readerError(r, "unterminated string");
+        }
+        if (c == '"')
+        {
+            return readerPut(r, '\0');
+        }
+        if (c != '\\')
+        {
+            if (readerPut(r, c) < 0)
+            {
+                return -1;
+            }
+            continue;
+        }
+
+        c = getc_unlocked(r->fp);
+        const char *escapes = "\"\"\\\\//b\bf\fn\nr\rt\t";
+        const char *e = c == EOF ? NULL : strchr(escapes, c);
+        if (c == 'u')
+        {
+            long cp = readHex4(r);
+            if (cp >= 0xD800 && cp < 0xDC00)
+            {
+                // surrogate pair
+                long low = (getc_unlocked(r->fp) == '\\' && getc_unlocked(r->fp) == 'u') ? readHex4(r) : -1;
+                if (low < 0xDC00 || low > 0xDFFF)
+                {
+                    return readerError(r, "invalid surrogate pair");
+                }
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            }
+            if (cp < 0 || putUtf8(r, cp) < 0)
+            {
+                return readerError(r, "invalid \\u escape");
+            }
+        }
+        else if (e && (e - escapes) % 2 == 0)
+        {
+            if (readerPut(r, e[1]) < 0)
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            return readerError(r, "invalid escape");
+        }
+    }
+}
+
+/**
+ * @brief Reads one flat JSON object, skipping the '[', ',' and ']' of an
+ * enclosing array, names go to nameOff and values to valueOff
+ * @return 1 on a record, 0 at end of file, -1 on error
+ */
+static int readJsonRecord(Reader *r)
+{
+    int c = skipSpace(r);
+    while (c == '[' || c == ',' || c == ']')
+    {
+        c = skipSpace(r);
+    }
+    if (c == EOF)
+    {
+        return 0;
+    }
+    if (c != '{')
+    {
+        return readerError(r, "expected an object");
+    }
+
+    r->len = 0;
+    r->count = 0;
+    c = skipSpace(r);
+    if (c == '}')
+    {
+        return 1;
+    }
+    while (1)
+    {
+        if (r->count == IMPORT_MAX_FIELDS)
+        {
+            return readerError(r, "too many fields");
+        }
+        if (c != '"')
+        {
+            return readerError(r, "expected a field name");
+        }
+        r->nameOff[r->count] = r->len;
+        if (readJsonString(r) < 0)
+        {
+            return -1;
+        }
+        if (skipSpace(r) != ':')
+        {
+            return readerError(r, "expected ':'");
+        }
+
+        c = skipSpace(r);
+        if (c == '"')
+        {
+            r->valueOff[r->count] = r->len;
+            if (readJsonString(r) < 0)
+            {
+                return -1;
+            }
+            c = skipSpace(r);
+        }
+        else if (c == '{' || c == '[')
+        {
+            return readerError(r, "nested values are not supported");
+        }
+        else
+        {
+            // number, true, false or null, kept as written
+            size_t start = r->len;
+            while (c != EOF && c != ',' && c != '}' && c != ' ' && c != '\t' && c != '\n' && c != '\r')
+            {
+                if (readerPut(r, c) < 0)
+                {
+                    return -1;
+                }
+                c = getc_unlocked(r->fp);
+            }
+            if (c == '\n')
+            {
+                r->line++;
+            }
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+            {
+                c = skipSpace(r);
+            }
+            if (readerPut(r, '\0') < 0)
+            {
+                return -1;
+            }
+            if (r->len == start + 1)
+            {
+                return readerError(r, "expected a value");
+            }
+            r->valueOff[r->count] = strcmp(r->buf + start, "null") == 0 ? (size_t)-1 : start;
+        }
+        r->count++;
+
+        if (c == '}')
+        {
+            return 1;
+        }
+        if (c != ',')
+        {
+            return readerError(r, "expected ',' or '}'");
+        }
+        c = skipSpace(r);
+    }
+}
+
+static int readerOpen(Reader *r, const char *path)
+{
+    memset(r, 0, sizeof(*r));
+    r->path = path;
+    r->line = 1;
+    r->fp = fopen(path, "r");
+    if (r->fp == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    const char *dot = strrchr(path, '.');
+    r->json = dot && (strcmp(dot, ".json") == 0 || strcmp(dot, ".jsonl") == 0);
+    if (r->json)
+    {
+        return 0;
+    }
+
+    int rc = readCsvRecord(r);
+    if (rc <= 0)
+    {
+        return rc < 0 ? -1 : readerError(r, "missing header row");
+    }
+    for (int i = 0; i < r->count; i++)
+    {
+        r->header[i] = strdup(r->valueOff[i] == (size_t)-1 ? "" : r->buf + r->valueOff[i]);
+        if (r->header[i] == NULL)
+        {
+            fprintf(stderr, "Not enough memory!\n");
+            return -1;
+        }
+        r->headerCount++;
+    }
+    return 0;
+}
+
+static void readerClose(Reader *r)
+{
+    if (r->fp)
+    {
+        fclose(r->fp);
+    }
+    for (int i = 0; i < r->headerCount; i++)
+    {
+        free(r->header[i]);
+    }
+    free(r->buf);
+}
+
+/**
+ * @brief Returns the name of field i of the record just read
+ */
+static const char *readerFieldName(Reader *r, int i)
+{
+    return r->json ? r->buf + r->nameOff[i] : (i < r->headerCount ? r->header[i] : "");
+}
+
+/**
+ * @brief Tells whether the record just read has a field called name,
+ * even a NULL one
+ */
+static int readerHasField(Reader *r, const char *name)
+{
+    for (int i = 0; i < r->count; i++)
+    {
+        if (strcasecmp(readerFieldName(r, i), name) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Reads the next record and returns the value of each column of
+ * table in values (NULL where missing)
+ * @return 1 on a record, 0 at end of file, -1 on error
+ */
+static int readerNext(Reader *r, const char **columns, int columnCount, const char **values)
+{
+    int rc = r->json ? readJsonRecord(r) : readCsvRecord(r);
+    if (rc <= 0)
+    {
+        return rc;
+    }
+
+    for (int col = 0; col < columnCount; col++)
+    {
+        values[col] = NULL;
+        for (int i = 0; i < r->count; i++)
+        {
+            if (strcasecmp(readerFieldName(r, i), columns[col]) == 0)
+            {
+                values[col] = r->valueOff[i] == (size_t)-1 ? NULL : r->buf + r->valueOff[i];
+                break;
+            }
+        }
+    }
+    return 1;
+}
+
+static int execSql(sqlite3 *db, const char *sql)
+{
+    char *zErrMsg = 0;
+    int rc = sqlite3_exec(db, sql, 0, 0, &zErrMsg);
+    if (rc != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", zErrMsg);
+        sqlite3_free(zErrMsg);
+        return -1;
+    }
+    return 0;
+}
+
+// rows every import must satisfy, whether loaded from a file or copied
+static const struct
+{
+    const char *table;
+    const char *problem;
+    const char *where; // condition selecting the offending rows
+} checks[] = {
+    {"courses", "an id that is not an integer", "typeof(id) != 'integer'"},
+    {"courses", "an empty Code", "Code IS NULL OR trim(Code) = ''"},
+    {"courses", "an empty Course", "Course IS NULL OR trim(Course) = ''"},
+    {"courses", "an empty University", "University IS NULL OR trim(University) = ''"},
+    {"courses", "Credits that are not a whole number", "typeof(Credits) != 'integer' OR Credits < 0"},
+    {"courses", "a Faculty missing from faculties for its University",
+     "NOT EXISTS (SELECT 1 FROM main.\"faculties\" f "
+     "WHERE f.Faculty = courses.Faculty AND f.University = courses.University)"},
+    {"subjectmap", "an id matching no course", "id IS NULL OR id NOT IN (SELECT id FROM main.\"courses\")"},
+    {"faculties", "an empty Faculty or University",
+     "Faculty IS NULL OR trim(Faculty) = '' OR University IS NULL OR trim(University) = ''"},
+    {"universities", "an empty University", "University IS NULL OR trim(University) = ''"},
+};
+
+/**
+ * @brief Runs the row checks on the new database, reporting the first
+ * record of each table that fails one; rows keep the order of their file
+ * @return 0 if every row passes, -1 otherwise
+ */
+static int validateRows(sqlite3 *db)
+{
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++)
+    {
+        char sql[512];
+        sqlite3_stmt *stmt;
+        snprintf(sql, sizeof(sql), "SELECT COUNT(*), MIN(rowid) FROM main.\"%s\" WHERE %s",
+                 checks[i].table, checks[i].where);
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK || sqlite3_step(stmt) != SQLITE_ROW)
+        {
+            fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+            sqlite3_finalize(stmt);
+            return -1;
+        }
+        long long count = sqlite3_column_int64(stmt, 0);
+        if (count > 0)
+        {
+            fprintf(stderr, "Error: %s: %lld %s with %s, the first is record %lld\n", checks[i].table, count,
+                    count == 1 ? "record" : "records", checks[i].problem, sqlite3_column_int64(stmt, 1));
+            failed = 1;
+        }
+        sqlite3_finalize(stmt);
+    }
+    return failed ? -1 : 0;
+}
+
+static sqlite3_stmt *prepareInsert(sqlite3 *db, const ImportTable *table)
+{
+    char sql[512];
+    sqlite3_stmt *stmt;
+    int n = snprintf(sql, sizeof(sql), "INSERT INTO main.\"%s\" VALUES (", table->name);
+    for (int i = 0; i < table->columnCount; i++)
+    {
+        n += snprintf(sql + n, sizeof(sql) - n, i ? ", ?" : "?");
+    }
+    snprintf(sql + n, sizeof(sql) - n, ")");
+
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+        return NULL;
+    }
+    return stmt;
+}
+
+static int insertRow(sqlite3 *db, sqlite3_stmt *stmt, const char **values, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (values[i])
+        {
+            // the column affinity turns numeric text of INTEGER columns into integers
+            sqlite3_bind_text(stmt, i + 1, values[i], -1, SQLITE_STATIC);
+        }
+        else
+        {
+            sqlite3_bind_null(stmt, i + 1);
+        }
+    }
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Streams file into table in batched transactions, also filling
+ * subjectmap from the SubjectMap column of courses when derive is set
+ * and a record has that column
+ * @param derived incremented for every subjectmap row filled
+ * @return rows inserted, or -1 on error
+ */
+static long long loadTable(sqlite3 *db, int t, const char *path, int derive, long long *derived)
+{
+    const ImportTable *table = &tables[t];
+    const ImportTable *sub = &tables[T_SUBJECTMAP];
+    Reader reader;
+    sqlite3_stmt *stmt = NULL, *subStmt = NULL;
+    const char *columns[9];
+    const char *values[9];
+    long long rows = -1, inBatch = 0;
+
+    memcpy(columns, table->columns, table->columnCount * sizeof(char *));
+    columns[table->columnCount] = "SubjectMap";
+
+    if (readerOpen(&reader, path) < 0)
+    {
+        goto done;
+    }
+    stmt = prepareInsert(db, table);
+    if (stmt == NULL || (derive && (subStmt = prepareInsert(db, sub)) == NULL))
+    {
+        goto done;
+    }
+    if (execSql(db, "BEGIN") < 0)
+    {
+        goto done;
+    }
+
+    rows = 0;
+    int rc;
+    while ((rc = readerNext(&reader, columns, table->columnCount + (derive ? 1 : 0), values)) == 1)
+    {
+        if (insertRow(db, stmt, values, table->columnCount) < 0)
+        {
+            fprintf(stderr, "Error: %s:%ld: row rejected\n", path, reader.line);
+            rows = -1;
+            break;
+        }
+        if (derive && readerHasField(&reader, "SubjectMap"))
+        {
+            // id, Code, Course of the course plus its SubjectMap link
+            const char *link[4] = {values[0], values[1], values[2], values[table->columnCount]};
+            if (insertRow(db, subStmt, link, 4) < 0)
+            {
+                rows = -1;
+                break;
+            }
+            (*derived)++;
+        }
+        rows++;
+        if (++inBatch == IMPORT_BATCH)
+        {
+            if (execSql(db, "COMMIT") < 0 || execSql(db, "BEGIN") < 0)
+            {
+                rows = -1;
+                break;
+            }
+            inBatch = 0;
+            fprintf(stderr, "%s: %lld rows\n", table->name, rows);
+        }
+    }
+    if (rc < 0)
+    {
+        rows = -1;
+    }
+    if (execSql(db, rows < 0 ? "ROLLBACK" : "COMMIT") < 0)
+    {
+        rows = -1;
+    }
+
+done:
+    sqlite3_finalize(stmt);
+    sqlite3_finalize(subStmt);
+    readerClose(&reader);
+    return rows;
+}
+
+/**
+ * @brief Copies the selected table of dbPath into the new database and
+ * write-locks dbPath through *lock, so a selection saved after the copy
+ * fails instead of being lost when the new file replaces dbPath
+ * @return 0 on success, -1 on failure
+ */
+static int copySelected(sqlite3 *db, const char *dbPath, sqlite3 **lock)
+{
+    char sql[600];
+
+    if (sqlite3_open(dbPath, lock) != SQLITE_OK)
+    {
+        fprintf(stderr, "Can't open database: %s\n", sqlite3_errmsg(*lock));
+        return -1;
+    }
+    sqlite3_busy_timeout(*lock, IMPORT_LOCK_TIMEOUT_MS);
+    if (execSql(*lock, "BEGIN IMMEDIATE") < 0)
+    {
+        return -1;
+    }
+
+    sqlite3_snprintf(sizeof(sql), sql, "ATTACH %Q AS old", dbPath);
+    if (execSql(db, sql) < 0 ||
+        execSql(db, "INSERT INTO main.\"selected\" SELECT * FROM old.\"selected\"") < 0 ||
+        execSql(db, "DETACH old") < 0)
+    {
+        return -1;
+    }
+    fprintf(stderr, "Copied %d rows into selected\n", sqlite3_changes(db));
+    return 0;
+}
+
+static int syncPath(const char *path, int flags)
+{
+    int fd = open(path, flags);
+    if (fd < 0 || fsync(fd) < 0)
+    {
+        perror(path);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+int importCatalog(const char *dbPath, int argc, char **argv)
+{
+    const char *files[TABLE_COUNT] = {NULL};
+    long long rows[TABLE_COUNT];
+    char tmpPath[512];
+    sqlite3 *db = NULL;
+    sqlite3 *lock = NULL; // write lock on dbPath held until the rename
+    int ok = 0;
+
+    for (int i = 0; i < argc; i++)
+    {
+        char *equals = strchr(argv[i], '=');
+        int t = 0;
+        if (equals)
+        {
+            *equals = '\0';
+            while (t < T_SELECTED && strcmp(tables[t].name, argv[i]) != 0)
+            {
+                t++;
+            }
+        }
+        if (equals == NULL || t == T_SELECTED)
+        {
+            fprintf(stderr, "Usage: server --import table=file ...\n"
+                            "tables: courses, subjectmap, faculties, universities\n");
+            return 1;
+        }
+        files[t] = equals + 1;
+    }
+    if (argc == 0)
+    {
+        fprintf(stderr, "Error: nothing to import\n");
+        return 1;
+    }
+
+    snprintf(tmpPath, sizeof(tmpPath), "%s.import", dbPath);
+    unlink(tmpPath);
+    if (sqlite3_open(tmpPath, &db) != SQLITE_OK)
+    {
+        fprintf(stderr, "Can't open database: %s\n", sqlite3_errmsg(db));
+        goto done;
+    }
+
+    // the file is only renamed into place once complete, so no journal is needed
+    if (execSql(db, "PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF; PRAGMA cache_size = -65536") < 0)
+    {
+        goto done;
+    }
+    for (int t = 0; t < TABLE_COUNT; t++)
+    {
+        if (execSql(db, tables[t].create) < 0)
+        {
+            goto done;
+        }
+    }
+
+    int haveOld = access(dbPath, R_OK) == 0;
+    if (haveOld)
+    {
+        char sql[600];
+        sqlite3_snprintf(sizeof(sql), sql, "ATTACH %Q AS old", dbPath);
+        if (execSql(db, sql) < 0)
+        {
+            goto done;
+        }
+    }
+
+    int derive = files[T_COURSES] && !files[T_SUBJECTMAP];
+    long long derived = 0;
+    for (int t = 0; t < TABLE_COUNT; t++)
+    {
+        if (files[t])
+        {
+            rows[t] = loadTable(db, t, files[t], t == T_COURSES && derive, &derived);
+            if (rows[t] < 0)
+            {
+                goto done;
+            }
+            fprintf(stderr, "Imported %lld rows into %s\n", rows[t], tables[t].name);
+        }
+        else if (t == T_SUBJECTMAP && derived > 0)
+        {
+            rows[t] = derived;
+        }
+        else if (haveOld && t != T_SELECTED)
+        {
+            // links of courses the import dropped go with them
+            char sql[256];
+            snprintf(sql, sizeof(sql), "INSERT INTO main.\"%s\" SELECT * FROM old.\"%s\"%s",
+                     tables[t].name, tables[t].name,
+                     t == T_SUBJECTMAP ? " WHERE id IN (SELECT id FROM main.\"courses\")" : "");
+            if (execSql(db, sql) < 0)
+            {
+                goto done;
+            }
+            rows[t] = sqlite3_changes(db);
+            if (t == T_SUBJECTMAP && derive)
+            {
+                fprintf(stderr, "courses has no SubjectMap column, kept %lld rows of subjectmap\n", rows[t]);
+            }
+        }
+        else
+        {
+            rows[t] = 0;
+        }
+    }
+    if (haveOld && execSql(db, "DETACH old") < 0)
+    {
+        goto done;
+    }
+
+    for (size_t i = 0; i < sizeof(indexes) / sizeof(indexes[0]); i++)
+    {
+        if (execSql(db, indexes[i]) < 0)
+        {
+            goto done;
+        }
+    }
+
+    if (validateRows(db) < 0)
+    {
+        goto done;
+    }
+    if (rows[T_COURSES] == 0)
+    {
+        fprintf(stderr, "Error: courses is empty\n");
+        goto done;
+    }
+    if (execSql(db, "ANALYZE") < 0)
+    {
+        goto done;
+    }
+    // selections are copied last, so those saved while the rows loaded are kept
+    if (haveOld && copySelected(db, dbPath, &lock) < 0)
+    {
+        goto done;
+    }
+    ok = 1;
+
+done:
+    sqlite3_close(db);
+    if (!ok || syncPath(tmpPath, O_RDONLY) < 0)
+    {
+        unlink(tmpPath);
+        sqlite3_close(lock);
+        fprintf(stderr, "Import failed, %s is unchanged\n", dbPath);
+        return 1;
+    }
+
+    // readers that already opened the old file keep it until they close it
+    if (rename(tmpPath, dbPath) < 0)
+    {
+        perror(dbPath);
+        unlink(tmpPath);
+        sqlite3_close(lock);
+        return 1;
+    }
+    sqlite3_close(lock);
+    char dir[512];
+    const char *slash = strrchr(dbPath, '/');
+    snprintf(dir, sizeof(dir), "%.*s", slash ? (int)(slash - dbPath) + 1 : 1, slash ? dbPath : ".");
+    syncPath(dir, O_RDONLY | O_DIRECTORY);
+
+    fprintf(stderr, "Imported catalog into %s\n", dbPath);
+    return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef IMPORT_H
+#define IMPORT_H
+
+/**
+ * @brief Builds a fresh copy of the database from catalog exports and
+ * atomically renames it over dbPath. Each argument is table=file where
+ * table is courses, subjectmap, faculties or universities and file is a
+ * CSV file with a header row or a JSON file of flat objects (an array
+ * or one object per line). Tables without a file are copied from the
+ * current database, subjectmap only for the courses still imported, as
+ * is the selected table, which is copied last. When
+ * courses is given without subjectmap and its file has a SubjectMap
+ * column, subjectmap is derived from the courses rows and that column.
+ * The import fails if a course lacks an integer id, a Code, a Course, a
+ * University or whole Credits, if its Faculty is not listed in faculties
+ * for its University, or if a subjectmap id matches no course.
+ * @param dbPath database to replace
+ * @param argc number of table=file arguments
+ * @param argv table=file arguments
+ * @return 0 on success, 1 on failure (dbPath is then left untouched)
+ */
+int importCatalog(const char *dbPath, int argc, char **argv);
+
+#endif
@@ -0,0 +1,491 @@
+#define _GNU_SOURCE // open_memstream
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <strings.h> // strcasecmp
+
+#include <sqlite3.h>
+
+#include "catalog.h"
+#include "pages.h"
+
+// slots of both templates
+enum
+{
+    SLOT_UNIVERSITIES, // section: one row per university (index)
+    SLOT_FACULTIES,    // section: one row per faculty (university page)
+    SLOT_PAGE,         // file name of the university page
+    SLOT_UNI,          // university code, the uni filter value
+    SLOT_NAME,         // full name of the university
+    SLOT_WEBSITE,
+    SLOT_INFO,
+    SLOT_N,     // 1-based row number
+    SLOT_VALUE, // faculty filter value
+    SLOT_LABEL, // faculty label
+    SLOT_SEMESTERS,     // section: one row per semester of the university's courses
+    SLOT_SEMESTER,      // semester filter value
+    SLOT_SEMESTER_LABEL,
+    SLOT_LEVELS,        // section: one row per study level of the university's courses
+    SLOT_LEVEL,         // study level filter value
+    SLOT_LEVEL_LABEL,
+    SLOT_COUNT
+};
+
+static const char *const slotNames[SLOT_COUNT] = {
+    "universities", "faculties", "page", "uni", "name", "website", "info", "n", "value", "label",
+    "semesters", "semester", "semesterLabel", "levels", "level", "levelLabel",
+};
+
+// labels of filter values stored abbreviated
+static const struct
+{
+    const char *value;
+    const char *label;
+} optionLabels[] = {
+    {"S", "Spring"},
+    {"W", "Winter"},
+};
+
+/**
+ * @brief Value and label of one filter checkbox
+ */
+typedef struct {
+    char *value;
+    char *label;
+} SiteOption;
+
+typedef struct {
+    int count;
+    int capacity;
+    SiteOption *items;
+} SiteOptions;
+
+typedef struct {
+    char page[PAGES_NAME_SIZE];
+    char *uni;
+    char *name;
+    char *website;
+    char *info;
+    SiteOptions faculties;
+    SiteOptions semesters;
+    SiteOptions levels;
+} SiteUniversity;
+
+typedef struct {
+    int count;
+    SiteUniversity *universities;
+    const SiteUniversity *current; // page being rendered, NULL for the index
+    char number[16];
+} Site;
+
+static char *columnText(sqlite3_stmt *stmt, int column)
+{
+    const char *text = (const char *)sqlite3_column_text(stmt, column);
+    return strdup(text ? text : "");
+}
+
+static void optionsFree(SiteOptions *options)
+{
+    for (int i = 0; i < options->count; i++)
+    {
+        free(options->items[i].value);
+        free(options->items[i].label);
+    }
+    free(options->items);
+}
+
+static void siteFree(Site *site)
+{
+    for (int i = 0; i < site->count; i++)
+    {
+        SiteUniversity *u = &site->universities[i];
+        optionsFree(&u->faculties);
+        optionsFree(&u->semesters);
+        optionsFree(&u->levels);
+        free(u->uni);
+        free(u->name);
+        free(u->website);
+        free(u->info);
+    }
+    free(site->universities);
+}
+
+/**
+ * @brief Appends an option, taking ownership of value and label
+ * @return 0 on success, -1 if out of memory (value and label are freed)
+ */
+static int addOption(SiteOptions *options, char *value, char *label)
+{
+    if (value == NULL || label == NULL)
+    {
+        free(value);
+        free(label);
+        return -1;
+    }
+    if (options->count == options->capacity)
+    {
+        int capacity = options->capacity ? options->capacity * 2 : 16;
+        SiteOption *grown = realloc(options->items, capacity * sizeof(SiteOption));
+        if (grown == NULL)
+        {
+            free(value);
+            free(label);
+            return -1;
+        }
+        options->items = grown;
+        options->capacity = capacity;
+    }
+    options->items[options->count].value = value;
+    options->items[options->count].label = label;
+    options->count++;
+    return 0;
+}
+
+static int loadFaculties(sqlite3_stmt *stmt, SiteUniversity *u)
+{
+    int rc;
+
+    sqlite3_reset(stmt);
+    sqlite3_bind_text(stmt, 1, u->uni, -1, SQLITE_STATIC);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        if (addOption(&u->faculties, columnText(stmt, 0), columnText(stmt, 1)) < 0)
+        {
+            return -1;
+        }
+    }
+    return rc == SQLITE_DONE ? 0 : -1;
+}
+
+static int compareOptions(const void *a, const void *b)
+{
+    return strcasecmp(((const SiteOption *)a)->value, ((const SiteOption *)b)->value);
+}
+
+/**
+ * @brief Collects the values of a courses column for one university as
+ * filter options. Stored values may list several, e.g. "W,S" or
+ * "Autumn, Spring"; each becomes its own option, split like the facet
+ * options of the catalog, since the search matches the column by
+ * substring.
+ * @param stmt distinct values of the column, the university bound as ?1
+ */
+static int loadOptions(sqlite3_stmt *stmt, const char *uni, SiteOptions *options)
+{
+    int rc;
+
+    sqlite3_reset(stmt);
+    sqlite3_bind_text(stmt, 1, uni, -1, SQLITE_STATIC);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const char *text = (const char *)sqlite3_column_text(stmt, 0);
+        const char *part;
+        size_t len;
+        while (text && (part = catalogNextOption(&text, &len)) != NULL)
+        {
+            int known = len == 0;
+            for (int i = 0; i < options->count && !known; i++)
+            {
+                known = strlen(options->items[i].value) == len && strncasecmp(options->items[i].value, part, len) == 0;
+            }
+            if (!known)
+            {
+                char *value = strndup(part, len);
+                const char *label = value;
+                for (size_t i = 0; value && i < sizeof(optionLabels) / sizeof(optionLabels[0]); i++)
+                {
+                    if (strcmp(value, optionLabels[i].value) == 0)
+                    {
+                        label = optionLabels[i].label;
+                    }
+                }
+                if (addOption(options, value, value ? strdup(label) : NULL) < 0)
+                {
+                    return -1;
+                }
+            }
+        }
+    }
+    if (options->count > 1)
+    {
+        qsort(options->items, options->count, sizeof(SiteOption), compareOptions);
+    }
+    return rc == SQLITE_DONE ? 0 : -1;
+}
+
+static int loadSite(Site *site, const char *dbPath)
+{
+    sqlite3 *db = NULL;
+    sqlite3_stmt *uniStmt = NULL;
+    sqlite3_stmt *facStmt = NULL;
+    sqlite3_stmt *semesterStmt = NULL;
+    sqlite3_stmt *levelStmt = NULL;
+    int capacity = 0;
+    int rc;
+
+    memset(site, 0, sizeof(Site));
+    rc = sqlite3_open_v2(dbPath, &db, SQLITE_OPEN_READONLY, NULL);
+    if (rc != SQLITE_OK)
+    {
+        fprintf(stderr, "Can't open database: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return -1;
+    }
+
+    // the code as spelled in courses, which the search filters compare against
+    rc = sqlite3_prepare_v2(db,
+                            "SELECT COALESCE((SELECT c.University FROM courses c"
+                            " WHERE c.University = u.University COLLATE NOCASE LIMIT 1), u.University),"
+                            " u.FullName, u.Website, u.Info FROM universities u ORDER BY u.rowid",
+                            -1, &uniStmt, NULL);
+    if (rc == SQLITE_OK)
+    {
+        // faculties without a full name are labelled with their code
+        rc = sqlite3_prepare_v2(db,
+                                "SELECT Faculty, CASE WHEN FullName IS NULL OR FullName = 'N/A'"
+                                " THEN Faculty ELSE FullName END FROM faculties"
+                                " WHERE University = ?1 COLLATE NOCASE ORDER BY rowid",
+                                -1, &facStmt, NULL);
+    }
+    if (rc == SQLITE_OK)
+    {
+        rc = sqlite3_prepare_v2(db, "SELECT DISTINCT Semester FROM courses WHERE University = ?1",
+                                -1, &semesterStmt, NULL);
+    }
+    if (rc == SQLITE_OK)
+    {
+        rc = sqlite3_prepare_v2(db, "SELECT DISTINCT Studylevel FROM courses WHERE University = ?1",
+                                -1, &levelStmt, NULL);
+    }
+    if (rc != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+        goto fail;
+    }
+
+    while ((rc = sqlite3_step(uniStmt)) == SQLITE_ROW)
+    {
+        if (site->count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 8;
+            SiteUniversity *grown = realloc(site->universities, capacity * sizeof(SiteUniversity));
+            if (grown == NULL)
+            {
+                fprintf(stderr, "Not enough memory!\n");
+                goto fail;
+            }
+            site->universities = grown;
+        }
+        SiteUniversity *u = &site->universities[site->count++];
+        memset(u, 0, sizeof(SiteUniversity));
+        u->uni = columnText(uniStmt, 0);
+        u->name = columnText(uniStmt, 1);
+        u->website = columnText(uniStmt, 2);
+        u->info = columnText(uniStmt, 3);
+
+        size_t len = 0;
+        for (const char *s = u->uni; *s && len + sizeof(".html") < PAGES_NAME_SIZE; s++)
+        {
+            u->page[len++] = isalnum((unsigned char)*s) ? tolower((unsigned char)*s) : '-';
+        }
+        strcpy(u->page + len, ".html");
+
+        if (loadFaculties(facStmt, u) < 0 || loadOptions(semesterStmt, u->uni, &u->semesters) < 0 ||
+            loadOptions(levelStmt, u->uni, &u->levels) < 0)
+        {
+            fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+            goto fail;
+        }
+    }
+    if (rc != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+        goto fail;
+    }
+
+    sqlite3_finalize(uniStmt);
+    sqlite3_finalize(facStmt);
+    sqlite3_finalize(semesterStmt);
+    sqlite3_finalize(levelStmt);
+    sqlite3_close(db);
+    return 0;
+
+fail:
+    sqlite3_finalize(uniStmt);
+    sqlite3_finalize(facStmt);
+    sqlite3_finalize(semesterStmt);
+    sqlite3_finalize(levelStmt);
+    sqlite3_close(db);
+    siteFree(site);
+    return -1;
+}
+
+static const char *siteValue(void *context, int slot, int row)
+{
+    Site *site = context;
+    const SiteUniversity *u = site->current;
+    if (u == NULL && row >= 0)
+    {
+        u = &site->universities[row];
+    }
+
+    if (slot == SLOT_N)
+    {
+        snprintf(site->number, sizeof(site->number), "%d", row + 1);
+        return site->number;
+    }
+    if (slot == SLOT_VALUE || slot == SLOT_LABEL || slot == SLOT_SEMESTER || slot == SLOT_SEMESTER_LABEL ||
+        slot == SLOT_LEVEL || slot == SLOT_LEVEL_LABEL)
+    {
+        if (site->current == NULL || row < 0)
+        {
+            return NULL;
+        }
+        const SiteOptions *options = &site->current->faculties;
+        if (slot == SLOT_SEMESTER || slot == SLOT_SEMESTER_LABEL)
+        {
+            options = &site->current->semesters;
+        }
+        else if (slot == SLOT_LEVEL || slot == SLOT_LEVEL_LABEL)
+        {
+            options = &site->current->levels;
+        }
+        if (row >= options->count)
+        {
+            return NULL;
+        }
+        const SiteOption *option = &options->items[row];
+        return slot == SLOT_VALUE || slot == SLOT_SEMESTER || slot == SLOT_LEVEL ? option->value : option->label;
+    }
+    if (u == NULL)
+    {
+        return NULL;
+    }
+    switch (slot)
+    {
+    case SLOT_PAGE:
+        return u->page;
+    case SLOT_UNI:
+        return u->uni;
+    case SLOT_NAME:
+        return u->name;
+    case SLOT_WEBSITE:
+        return u->website;
+    case SLOT_INFO:
+        return u->info;
+    }
+    return NULL;
+}
+
+static int siteRows(void *context, int slot)
+{
+    Site *site = context;
+    if (slot == SLOT_UNIVERSITIES)
+    {
+        return site->current ? 0 : site->count;
+    }
+    if (site->current == NULL)
+    {
+        return 0;
+    }
+    switch (slot)
+    {
+    case SLOT_FACULTIES:
+        return site->current->faculties.count;
+    case SLOT_SEMESTERS:
+        return site->current->semesters.count;
+    case SLOT_LEVELS:
+        return site->current->levels.count;
+    }
+    return 0;
+}
+
+static int renderPage(Page *page, const char *name, const Template *tpl, Site *site)
+{
+    snprintf(page->name, sizeof(page->name), "%s", name);
+    FILE *out = open_memstream(&page->body, &page->len);
+    if (out == NULL)
+    {
+        return -1;
+    }
+    TemplateData data = {site, siteValue, siteRows};
+    templateRender(tpl, &data, out);
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+int pagesLoadTemplates(PageTemplates *templates, const char *dir)
+{
+    char path[256];
+
+    snprintf(path, sizeof(path), "%s/index.html", dir);
+    if (templateLoad(&templates->index, path, slotNames, SLOT_COUNT) < 0)
+    {
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/university.html", dir);
+    if (templateLoad(&templates->university, path, slotNames, SLOT_COUNT) < 0)
+    {
+        templateFree(&templates->index);
+        return -1;
+    }
+    return 0;
+}
+
+int pagesBuild(Pages *pages, const PageTemplates *templates, const char *dbPath)
+{
+    Site site;
+
+    memset(pages, 0, sizeof(Pages));
+    if (loadSite(&site, dbPath) < 0)
+    {
+        return -1;
+    }
+
+    pages->pages = (Page *)calloc(site.count + 1, sizeof(Page));
+    if (pages->pages == NULL)
+    {
+        fprintf(stderr, "Not enough memory!\n");
+        siteFree(&site);
+        return -1;
+    }
+
+    int result = renderPage(&pages->pages[pages->count++], "index.html", &templates->index, &site);
+    for (int i = 0; i < site.count && result == 0; i++)
+    {
+        site.current = &site.universities[i];
+        result = renderPage(&pages->pages[pages->count++], site.current->page, &templates->university, &site);
+    }
+    siteFree(&site);
+
+    if (result < 0)
+    {
+        fprintf(stderr, "Error: rendering the pages failed\n");
+        pagesFree(pages);
+        return -1;
+    }
+    return 0;
+}
+
+const Page *pagesFind(const Pages *pages, const char *name)
+{
+    for (int i = 0; i < pages->count; i++)
+    {
+        if (strcmp(pages->pages[i].name, name) == 0)
+        {
+            return &pages->pages[i];
+        }
+    }
+    return NULL;
+}
+
+void pagesFree(Pages *pages)
+{
+    for (int i = 0; i < pages->count; i++)
+    {
+        free(pages->pages[i].body);
+    }
+    free(pages->pages);
+    memset(pages, 0, sizeof(Pages));
+}
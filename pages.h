@@ -0,0 +1,56 @@
+#ifndef PAGES_H
+#define PAGES_H
+
+#include <stddef.h>
+
+#include "template.h"
+
+#define PAGES_NAME_SIZE 64
+
+/**
+ * @brief Templates of the generated pages, compiled once at startup
+ */
+typedef struct {
+    Template index;      // list of universities
+    Template university; // course search form of one university
+} PageTemplates;
+
+/**
+ * @brief Rendered page, served like a static file
+ */
+typedef struct {
+    char name[PAGES_NAME_SIZE]; // file name under htdocs, e.g. dtu.html
+    char *body;
+    size_t len;
+} Page;
+
+typedef struct {
+    int count;
+    Page *pages;
+} Pages;
+
+/**
+ * @brief Compiles index.html and university.html of directory dir
+ * @return 0 on success, -1 on failure
+ */
+int pagesLoadTemplates(PageTemplates *templates, const char *dir);
+
+/**
+ * @brief Renders index.html and one page per row of the universities
+ * table, named after its lowercased university code, with the faculties
+ * of the faculties table and the semesters and study levels found in its
+ * courses as filter checkboxes
+ * @param pages pages to fill
+ * @param dbPath path of the sqlite database
+ * @return 0 on success, -1 on failure
+ */
+int pagesBuild(Pages *pages, const PageTemplates *templates, const char *dbPath);
+
+/**
+ * @brief Returns the page with the given file name or NULL
+ */
+const Page *pagesFind(const Pages *pages, const char *name);
+
+void pagesFree(Pages *pages);
+
+#endif
@@ -0,0 +1,451 @@
+#define _GNU_SOURCE // qsort_r
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>  // sysconf
+#include <pthread.h>
+
+#include "plan.h"
+
+#define CHECK_INTERVAL 1024 // search nodes between deadline checks
+#define PARALLEL_MIN 64     // fewer candidate courses are searched on one thread
+
+/**
+ * @brief Search state shared by all workers. Items are the candidate
+ * courses sorted by credits, largest first.
+ */
+typedef struct {
+    const Catalog *cat;
+    const PlanQuery *query;
+    int n;
+    uint32_t *course;  // catalog index of each item
+    int *credits;      // credits of each item
+    uint32_t *group;   // code group of each item
+    int *prefix;       // prefix[i] = credits of items 0..i-1
+    uint64_t *baseUsed; // code groups taken by the included courses
+    uint32_t groupWords;
+    int baseCredits;
+    int baseCount;
+    int threads;
+    struct timespec deadline;
+    long threshold; // best k-th score found by any worker
+    int stop;
+} Search;
+
+typedef struct {
+    long score;
+    int len;
+    uint32_t items[PLAN_MAX_COURSES];
+} Candidate;
+
+typedef struct {
+    Search *search;
+    int thread;
+    uint64_t *used;
+    uint32_t path[PLAN_MAX_COURSES];
+    Candidate best[PLAN_MAX_K];
+    int bestCount;
+    long nodes;
+    pthread_t tid;
+} Worker;
+
+static long planScore(int credits, int count)
+{
+    return (long)credits * (PLAN_MAX_COURSES + 1) - count;
+}
+
+/**
+ * @brief Orders candidates best first: higher score, then the
+ * lexicographically smaller item sequence
+ */
+static int compareCandidates(const void *a, const void *b)
+{
+    const Candidate *x = a, *y = b;
+    if (x->score != y->score)
+    {
+        return x->score > y->score ? -1 : 1;
+    }
+    for (int i = 0; i < x->len && i < y->len; i++)
+    {
+        if (x->items[i] != y->items[i])
+        {
+            return x->items[i] < y->items[i] ? -1 : 1;
+        }
+    }
+    return x->len - y->len;
+}
+
+static int compareItems(const void *a, const void *b, void *arg)
+{
+    const Search *s = arg;
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    const CatalogCourse *cx = &s->cat->courses[x], *cy = &s->cat->courses[y];
+    if (cx->credits != cy->credits)
+    {
+        return cx->credits > cy->credits ? -1 : 1;
+    }
+    return x < y ? -1 : x > y;
+}
+
+static int compareCodes(const void *a, const void *b, void *arg)
+{
+    const Catalog *cat = arg;
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    uint32_t cx = cat->courses[x].code, cy = cat->courses[y].code;
+    return cx < cy ? -1 : cx > cy;
+}
+
+static int compareIndexes(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static int timeUp(Search *s)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec > s->deadline.tv_sec ||
+        (now.tv_sec == s->deadline.tv_sec && now.tv_nsec >= s->deadline.tv_nsec))
+    {
+        __atomic_store_n(&s->stop, 1, __ATOMIC_RELAXED);
+    }
+    return __atomic_load_n(&s->stop, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Records the current path as a plan if it makes the worker's top k
+ */
+static void offer(Worker *w, int len, int credits, int count)
+{
+    Search *s = w->search;
+    int k = s->query->topK;
+    long score = planScore(credits, count);
+
+    // paths are visited in lexicographic order, so a tie loses to what is kept
+    if (w->bestCount == k && score <= w->best[k - 1].score)
+    {
+        return;
+    }
+
+    int pos = w->bestCount < k ? w->bestCount++ : k - 1;
+    while (pos > 0 && w->best[pos - 1].score < score)
+    {
+        w->best[pos] = w->best[pos - 1];
+        pos--;
+    }
+    w->best[pos].score = score;
+    w->best[pos].len = len;
+    memcpy(w->best[pos].items, w->path, len * sizeof(uint32_t));
+
+    if (w->bestCount == k)
+    {
+        long worst = w->best[k - 1].score;
+        long shared = __atomic_load_n(&s->threshold, __ATOMIC_RELAXED);
+        while (worst > shared &&
+               !__atomic_compare_exchange_n(&s->threshold, &shared, worst, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+        }
+    }
+}
+
+/**
+ * @brief Depth-first branch and bound over items start, start + step, ...
+ */
+static void branch(Worker *w, int start, int step, int depth, int credits, int count)
+{
+    Search *s = w->search;
+    const PlanQuery *q = s->query;
+
+    for (int j = start; j < s->n; j += step)
+    {
+        if (++w->nodes % CHECK_INTERVAL == 0 && timeUp(s))
+        {
+            return;
+        }
+
+        int c = s->credits[j];
+        if (credits + c > q->maxCredits || bitsetTest(w->used, s->group[j]))
+        {
+            continue;
+        }
+
+        // the free slots filled with the next largest items bound every
+        // plan below this node; the bound only shrinks as j grows
+        int end = j + q->maxCourses - count;
+        if (end > s->n)
+        {
+            end = s->n;
+        }
+        int bound = credits + s->prefix[end] - s->prefix[j];
+        if (bound > q->maxCredits)
+        {
+            bound = q->maxCredits;
+        }
+        if (bound < q->minCredits)
+        {
+            break;
+        }
+        // fewest items that can add up to the bound, found on the prefix sums
+        int lo = j + 1, hi = end;
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if (credits + s->prefix[mid] - s->prefix[j] >= bound)
+            {
+                hi = mid;
+            }
+            else
+            {
+                lo = mid + 1;
+            }
+        }
+        long boundScore = planScore(bound, count + lo - j);
+        if (w->bestCount == q->topK && boundScore <= w->best[q->topK - 1].score)
+        {
+            break;
+        }
+        if (boundScore < __atomic_load_n(&s->threshold, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+
+        bitsetSet(w->used, s->group[j]);
+        w->path[depth] = j;
+        if (credits + c >= q->minCredits)
+        {
+            offer(w, depth + 1, credits + c, count + 1);
+        }
+        if (count + 1 < q->maxCourses && credits + c < q->maxCredits)
+        {
+            branch(w, j + 1, 1, depth + 1, credits + c, count + 1);
+        }
+        w->used[s->group[j] >> 6] &= ~((uint64_t)1 << (s->group[j] & 63));
+
+        if (__atomic_load_n(&s->stop, __ATOMIC_RELAXED))
+        {
+            return;
+        }
+    }
+}
+
+static void *workerRun(void *arg)
+{
+    Worker *w = arg;
+    Search *s = w->search;
+
+    memcpy(w->used, s->baseUsed, s->groupWords * sizeof(uint64_t));
+    // each worker owns every threads-th choice of the first extra course
+    if (s->baseCount < s->query->maxCourses && s->baseCredits < s->query->maxCredits)
+    {
+        branch(w, w->thread, s->threads, 0, s->baseCredits, s->baseCount);
+    }
+    return NULL;
+}
+
+int planSearch(const Catalog *cat, const PlanQuery *query, PlanResult *result)
+{
+    Search s;
+    Worker *workers = NULL;
+    uint32_t *byCode = NULL;
+    int rc = -1;
+
+    memset(result, 0, sizeof(*result));
+    memset(&s, 0, sizeof(s));
+
+    if (query->minCredits < 0 || query->minCredits > query->maxCredits ||
+        query->topK < 1 || query->topK > PLAN_MAX_K ||
+        query->maxCourses < 1 || query->maxCourses > PLAN_MAX_COURSES ||
+        query->includeCount > query->maxCourses)
+    {
+        return -1;
+    }
+
+    s.cat = cat;
+    s.query = query;
+    s.course = malloc(cat->courseCount * sizeof(uint32_t));
+    s.credits = malloc(cat->courseCount * sizeof(int));
+    s.group = malloc(cat->courseCount * sizeof(uint32_t));
+    s.prefix = malloc((cat->courseCount + 1) * sizeof(int));
+    byCode = malloc(cat->courseCount * sizeof(uint32_t));
+    s.groupWords = cat->bitsetWords + 1;
+    s.baseUsed = calloc(s.groupWords, sizeof(uint64_t));
+    if (!s.course || !s.credits || !s.group || !s.prefix || !byCode || !s.baseUsed)
+    {
+        fprintf(stderr, "Not enough memory!\n");
+        goto done;
+    }
+
+    // number the distinct codes so that taking a course blocks its twins
+    uint32_t *codeGroup = s.group; // indexed by catalog index until items are built
+    for (uint32_t i = 0; i < cat->courseCount; i++)
+    {
+        byCode[i] = i;
+    }
+    qsort_r(byCode, cat->courseCount, sizeof(uint32_t), compareCodes, (void *)cat);
+    uint32_t groups = 0;
+    for (uint32_t i = 0; i < cat->courseCount; i++)
+    {
+        if (i > 0 && cat->courses[byCode[i]].code != cat->courses[byCode[i - 1]].code)
+        {
+            groups++;
+        }
+        codeGroup[byCode[i]] = groups;
+    }
+
+    for (int i = 0; i < query->includeCount; i++)
+    {
+        uint32_t idx = query->include[i];
+        if (idx >= cat->courseCount || bitsetTest(s.baseUsed, codeGroup[idx]))
+        {
+            goto done; // unknown course or two courses with one code
+        }
+        bitsetSet(s.baseUsed, codeGroup[idx]);
+        s.baseCredits += cat->courses[idx].credits;
+        s.baseCount++;
+    }
+
+    // candidates: allowed, not included, worth credits, no clash with included codes
+    for (uint32_t i = 0; i < cat->courseCount; i++)
+    {
+        const CatalogCourse *c = &cat->courses[i];
+        if (bitsetTest(query->allowed, i) && c->credits > 0 &&
+            c->credits <= query->maxCredits && !bitsetTest(s.baseUsed, codeGroup[i]))
+        {
+            s.course[s.n++] = i;
+        }
+    }
+    qsort_r(s.course, s.n, sizeof(uint32_t), compareItems, &s);
+    for (int j = 0; j < s.n; j++)
+    {
+        byCode[j] = codeGroup[s.course[j]];
+    }
+    s.prefix[0] = 0;
+    for (int j = 0; j < s.n; j++)
+    {
+        s.group[j] = byCode[j];
+        s.credits[j] = cat->courses[s.course[j]].credits;
+        s.prefix[j + 1] = s.prefix[j] + s.credits[j];
+    }
+
+    s.threads = 1;
+    if (s.n >= PARALLEL_MIN)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        s.threads = cores < 1 ? 1 : cores > PLAN_MAX_THREADS ? PLAN_MAX_THREADS : cores;
+    }
+    s.threshold = -1;
+    clock_gettime(CLOCK_MONOTONIC, &s.deadline);
+    s.deadline.tv_sec += query->budgetMs / 1000;
+    s.deadline.tv_nsec += (query->budgetMs % 1000) * 1000000L;
+    if (s.deadline.tv_nsec >= 1000000000L)
+    {
+        s.deadline.tv_sec++;
+        s.deadline.tv_nsec -= 1000000000L;
+    }
+
+    workers = calloc(s.threads, sizeof(Worker));
+    if (workers == NULL)
+    {
+        fprintf(stderr, "Not enough memory!\n");
+        goto done;
+    }
+    int started = 0;
+    for (int t = 0; t < s.threads; t++)
+    {
+        workers[t].search = &s;
+        workers[t].thread = t;
+        workers[t].used = malloc(s.groupWords * sizeof(uint64_t));
+        if (workers[t].used == NULL)
+        {
+            fprintf(stderr, "Not enough memory!\n");
+            __atomic_store_n(&s.stop, 1, __ATOMIC_RELAXED);
+            s.threads = t;
+            break;
+        }
+    }
+    // worker 0 runs on the calling thread
+    for (int t = 1; t < s.threads; t++)
+    {
+        if (pthread_create(&workers[t].tid, NULL, workerRun, &workers[t]) != 0)
+        {
+            break;
+        }
+        started = t;
+    }
+    if (started < s.threads - 1)
+    {
+        // a worker could not start, so its share of the tree is left unsearched
+        __atomic_store_n(&s.stop, 1, __ATOMIC_RELAXED);
+    }
+    if (s.threads > 0)
+    {
+        workerRun(&workers[0]);
+    }
+    for (int t = 1; t <= started; t++)
+    {
+        pthread_join(workers[t].tid, NULL);
+    }
+
+    // merge the per-worker top k lists, plus the included courses alone
+    int total = 0;
+    Candidate *all = malloc((s.threads * query->topK + 1) * sizeof(Candidate));
+    if (all == NULL)
+    {
+        fprintf(stderr, "Not enough memory!\n");
+        goto done;
+    }
+    if (s.baseCount > 0 && s.baseCredits >= query->minCredits && s.baseCredits <= query->maxCredits)
+    {
+        all[total].score = planScore(s.baseCredits, s.baseCount);
+        all[total].len = 0;
+        total++;
+    }
+    for (int t = 0; t < s.threads; t++)
+    {
+        memcpy(all + total, workers[t].best, workers[t].bestCount * sizeof(Candidate));
+        total += workers[t].bestCount;
+        result->nodes += workers[t].nodes;
+    }
+    qsort(all, total, sizeof(Candidate), compareCandidates);
+
+    for (int i = 0; i < total && i < query->topK; i++)
+    {
+        Plan *plan = &result->plans[result->count++];
+        plan->credits = s.baseCredits;
+        plan->count = 0;
+        for (int j = 0; j < query->includeCount; j++)
+        {
+            plan->courses[plan->count++] = query->include[j];
+        }
+        for (int j = 0; j < all[i].len; j++)
+        {
+            plan->courses[plan->count++] = s.course[all[i].items[j]];
+            plan->credits += s.credits[all[i].items[j]];
+        }
+        qsort(plan->courses, plan->count, sizeof(uint32_t), compareIndexes);
+    }
+    free(all);
+    result->complete = !s.stop;
+    rc = 0;
+
+done:
+    if (workers)
+    {
+        for (int t = 0; t < s.threads; t++)
+        {
+            free(workers[t].used);
+        }
+    }
+    free(workers);
+    free(byCode);
+    free(s.course);
+    free(s.credits);
+    free(s.group);
+    free(s.prefix);
+    free(s.baseUsed);
+    return rc;
+}
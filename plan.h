@@ -0,0 +1,52 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+#include <stdint.h>
+
+#include "catalog.h"
+
+#define PLAN_MAX_COURSES 16 // courses in one plan
+#define PLAN_MAX_K 20       // plans returned by one search
+#define PLAN_MAX_THREADS 16
+
+/**
+ * @brief Constraints of a study-plan search
+ */
+typedef struct {
+    int minCredits;
+    int maxCredits;
+    int topK;
+    int maxCourses;
+    int budgetMs;              // time budget of the search
+    const uint64_t *allowed;   // bitset of courses the plan may use
+    const uint32_t *include;   // catalog indexes every plan must contain
+    int includeCount;
+} PlanQuery;
+
+/**
+ * @brief One course combination, course indexes in catalog order
+ */
+typedef struct {
+    int credits;
+    int count;
+    uint32_t courses[PLAN_MAX_COURSES];
+} Plan;
+
+typedef struct {
+    int count;
+    int complete; // 0 when the time budget ran out before the search ended
+    long nodes;   // search nodes visited
+    Plan plans[PLAN_MAX_K];
+} PlanResult;
+
+/**
+ * @brief Finds the best course combinations whose credits fall in
+ * [minCredits, maxCredits]. Plans with more credits rank first, then
+ * plans with fewer courses. Two courses sharing a code never appear in
+ * the same plan. The search is a branch and bound over the allowed
+ * courses, split across worker threads.
+ * @return 0 on success, -1 if the query is invalid
+ */
+int planSearch(const Catalog *cat, const PlanQuery *query, PlanResult *result);
+
+#endif
@@ -10,13 +10,40 @@
 
 #include <signal.h> // signal handling
 #include <time.h>   // time
+#include <pthread.h> // catalog reload thread
+#include <stddef.h>  // offsetof
 
 #include <sqlite3.h> 
 
+#include "catalog.h"
+#include "plan.h"
+#include "similar.h"
+#include "snapshot.h"
+#include "import.h"
+#include "pages.h"
+#include "admission.h"
+#include "eventloop.h"
+#include "server.h"
+
 #define SIZE 1024  // buffer size
 #define PORT 2728  // port number
-#define BACKLOG 10 // number of pending connections queue will hold
+#define BACKLOG 128 // number of pending connections queue will hold
+#define MAX_CONNECTIONS 256 // open client connections before new ones get 503
+#define MAX_QUERIES 16      // searches queued or running before new ones get 503
+#define CLIENT_RATE 20      // searches per second per client IP
+#define CLIENT_BURST 40     // searches a client IP may send at once
+#define HEADER_TIMEOUT 10   // seconds to receive a request head
+#define BODY_TIMEOUT 30     // seconds to receive a request body
+#define WRITE_TIMEOUT 30    // seconds to send a response
+#define IDLE_TIMEOUT 5      // seconds a kept-alive connection waits for a request
 #define SUBMAP_SIZE 20
+#define DATABASE "euroteq.db"
+#define SNAPSHOT "euroteq.snap" // catalog snapshot built by make snapshot
+#define TEMPLATES "templates" // page templates, compiled at startup
+#define CATALOG_POLL_SECONDS 1 // how often the database file is checked for a new import
+#define PLAN_BUDGET_MS 40 // default and longest time budget of a /plan search
+#define SUGGEST_MAX 20     // suggestions returned by one /suggest lookup
+#define SIMILAR_K 10       // default matches returned by /similar
 
 /**
  * @brief Generates file URL based on route
@@ -37,6 +64,11 @@ void getMimeType(char *file, char *mime);
  */
 void handleSignal(int signal);
 
+/**
+ * @brief Prints the command line options
+ */
+void printUsage(void);
+
 /**
  * @brief Returns a string with the current time in HTTP response date format
  * @param buf buffer to store the time string
@@ -51,24 +83,179 @@ typedef struct {
     int subMap;
     int selected;
     int credits;
+    char *facets; // facet counts written above the table, or NULL
+    const char **params; // values bound to the ? of the search query
+    int paramCount;
 } CallbackData;
 
+/**
+ * @brief Returns the faculty name for a short code of the search forms,
+ * or the value itself when it is not a known code
+ */
+const char *facultyName(const char *value);
+
+/**
+ * @brief Returns the catalog dimension filtered by a query key, or -1
+ */
+int queryDimension(const char *key);
+
+/**
+ * @brief Writes the facet counts of a search as HTML
+ * @param counts counts per dimension and option id from catalogFacetCounts
+ * @param total number of courses matching the whole search
+ */
+void writeFacets(FILE *fp, uint32_t counts[CATALOG_DIMS][CATALOG_MAX_VALUES], uint32_t total);
+
+/**
+ * @brief Decodes '+' and %XX escapes of a query string component in place
+ */
+void urlDecode(char *s);
+
+/**
+ * @brief Splits the next key=value pair off a query string and decodes it
+ * @param cursor position in the query string, advanced past the pair
+ * @param key set to the decoded key
+ * @param value set to the decoded value ("" when the pair has no '=')
+ * @return 1 if a pair was read, 0 at the end of the query string
+ */
+int nextQueryParam(char **cursor, char **key, char **value);
+
+/**
+ * @brief Writes a complete HTTP response to the response of the request
+ */
+void sendResponse(const char *status, const char *mime, const char *body, size_t len);
+
+/**
+ * @brief Writes s to fp as a JSON string literal
+ */
+void writeJsonString(FILE *fp, const char *s);
+
+/**
+ * @brief Answers /plan with the best course combinations for a credit target
+ * @param query query string of the request, modified while parsed
+ */
+void handlePlan(char *query);
+
+/**
+ * @brief Answers /suggest with courses whose code or name starts with q
+ * @param query query string of the request, modified while parsed
+ */
+void handleSuggest(char *query);
+
+/**
+ * @brief Answers /similar with the courses of other universities closest
+ * to course id
+ * @param query query string of the request, modified while parsed
+ */
+void handleSimilar(char *query);
+
+/**
+ * @brief Writes id, code, name and university of a course as the fields
+ * of an unterminated JSON object
+ */
+void writeCourseJson(FILE *fp, const CatalogCourse *c);
+
+/**
+ * @brief Returns the query string of route if its path is path, else NULL
+ */
+char *routeQuery(char *route, const char *path);
+
+/**
+ * @brief Reloads the catalog in the background whenever an import changes
+ * the catalog tables and hands it to the request loop through freshCatalog
+ * @param arg CatalogSource of the catalog loaded at startup
+ */
+void *catalogReloader(void *arg);
+
 void sqlQuery(const char *data, FILE *fGiven, sqlite3 *dbGiven, CallbackData *dbData, int *choices, int choicesCnt);
 static int callback(void *data, int argc, char **argv, char **NotUsed);
+
+/**
+ * @brief Runs sql like sqlite3_exec with callback, binding params to its
+ * ? placeholders
+ * @return SQLITE_OK or the error code, see sqlite3_errmsg
+ */
+static int sqlExecBound(sqlite3 *db, const char *sql, const char **params, int paramCount, CallbackData *data);
 int choicesArr(int n, int *choices);
 
 int serverSocket;
-int clientSocket;
 
-char *request;
+FILE *responseFile; // response of the request being handled
+
+Catalog *catalog;      // catalog used by the request loop
+Catalog *freshCatalog; // reloaded catalog waiting to replace it
 
+PageTemplates templates; // compiled page templates
+Pages *pages;            // rendered university pages
+Pages *freshPages;       // pages rendered after an import, waiting to replace them
 
 
-int main()
+int main(int argc, char *argv[])
 {
+  // import mode: rebuild the database from catalog exports and exit
+  if (argc > 1 && strcmp(argv[1], "--import") == 0)
+  {
+    return importCatalog(DATABASE, argc - 2, argv + 2);
+  }
+
+  // snapshot mode: compile the catalog and its indexes into SNAPSHOT and exit
+  if (argc > 1 && strcmp(argv[1], "--snapshot") == 0)
+  {
+    Catalog built;
+    return catalogLoad(&built, DATABASE) < 0 || snapshotWrite(&built, SNAPSHOT) < 0;
+  }
+
+  // load limits, see printUsage
+  AdmissionConfig limits = {BACKLOG, MAX_CONNECTIONS, MAX_QUERIES, CLIENT_RATE, CLIENT_BURST,
+                           HEADER_TIMEOUT, BODY_TIMEOUT, WRITE_TIMEOUT, IDLE_TIMEOUT};
+  int backend = BACKEND_EPOLL;
+  for (int i = 1; i < argc; i++)
+  {
+    if (i + 1 == argc)
+    {
+      printUsage();
+      return 1;
+    }
+    if (strcmp(argv[i], "--backlog") == 0)
+      limits.backlog = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--max-connections") == 0)
+      limits.maxConnections = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--max-queries") == 0)
+      limits.maxQueries = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--rate") == 0)
+      limits.rate = atof(argv[++i]);
+    else if (strcmp(argv[i], "--burst") == 0)
+      limits.burst = atof(argv[++i]);
+    else if (strcmp(argv[i], "--header-timeout") == 0)
+      limits.headerTimeout = atof(argv[++i]);
+    else if (strcmp(argv[i], "--body-timeout") == 0)
+      limits.bodyTimeout = atof(argv[++i]);
+    else if (strcmp(argv[i], "--write-timeout") == 0)
+      limits.writeTimeout = atof(argv[++i]);
+    else if (strcmp(argv[i], "--idle-timeout") == 0)
+      limits.idleTimeout = atof(argv[++i]);
+    else if (strcmp(argv[i], "--backend") == 0 && strcmp(argv[i + 1], "epoll") == 0)
+      backend = BACKEND_EPOLL, i++;
+    else if (strcmp(argv[i], "--backend") == 0 && strcmp(argv[i + 1], "io_uring") == 0)
+      backend = BACKEND_URING, i++;
+    else
+    {
+      printUsage();
+      return 1;
+    }
+  }
+  if (limits.backlog < 1 || limits.maxConnections < 1 || limits.maxQueries < 1 ||
+      limits.rate < 0 || limits.burst < 1 || limits.headerTimeout <= 0 ||
+      limits.bodyTimeout <= 0 || limits.writeTimeout <= 0 || limits.idleTimeout <= 0)
+  {
+    printUsage();
+    return 1;
+  }
 
   // register signal handler
   signal(SIGINT, handleSignal);
+  // a client closing early must not kill the server on send
+  signal(SIGPIPE, SIG_IGN);
 
   // server internet socket address
   struct sockaddr_in serverAddress;
@@ -90,7 +277,7 @@ int main()
   }
 
   // listen for connections
-  if (listen(serverSocket, BACKLOG) < 0)
+  if (listen(serverSocket, limits.backlog) < 0)
   {
     printf("Error: The server is not listening.\n");
     return 1;
@@ -107,83 +294,179 @@ int main()
     return 1;
   }
 
-  printf("\nServer is listening on http://%s:%s/\n\n", hostBuffer, serviceBuffer);
+  // in-memory catalog for the endpoints that do not go through SQL
+  // mapped from the snapshot when it matches the database, else built from SQLite
+  catalog = (Catalog *)malloc(sizeof(Catalog));
+  if (catalog == NULL ||
+      (snapshotLoad(catalog, SNAPSHOT, DATABASE) < 0 && catalogLoad(catalog, DATABASE) < 0))
+  {
+    printf("Error: The course catalog could not be loaded.\n");
+    return 1;
+  }
 
-  while (1)
+  // university pages are rendered from the database, not kept in htdocs
+  pages = (Pages *)malloc(sizeof(Pages));
+  if (pages == NULL || pagesLoadTemplates(&templates, TEMPLATES) < 0 ||
+      pagesBuild(pages, &templates, DATABASE) < 0)
   {
-    // buffer to store data (request)
-    request = (char *)malloc(SIZE * sizeof(char));
-    char method[10], route[100];
+    printf("Error: The university pages could not be built.\n");
+    return 1;
+  }
 
-    // accept connection and read data
-    clientSocket = accept(serverSocket, NULL, NULL);
-    read(clientSocket, request, SIZE);
+  pthread_t reloader;
+  CatalogSource *loadedSource = (CatalogSource *)malloc(sizeof(CatalogSource));
+  *loadedSource = catalog->source;
+  if (pthread_create(&reloader, NULL, catalogReloader, loadedSource) != 0)
+  {
+    printf("Error: The catalog reload thread could not be started.\n");
+    return 1;
+  }
 
-    // parse HTTP request
-    sscanf(request, "%s %s", method, route);
-    printf("%s %s", method, route);
+  printf("\nServer is listening on http://%s:%s/\n\n", hostBuffer, serviceBuffer);
 
-    free(request);
+  return serveEvents(serverSocket, &limits, backend);
+}
 
-    // only support GET method
-    if (strcmp(method, "GET") != 0)
-    {
-      const char response[] = "HTTP/1.1 400 Bad Request\r\n\n";
-      send(clientSocket, response, sizeof(response), 0);
-    }
-    else
-    {
-      char fileURL[100];
+void handleRequest(char *request, char **response, size_t *responseLen)
+{
+  char method[10] = "", route[REQUEST_SIZE + 16] = ""; // room for index.html
 
-      // generate file URL
-      getFileURL(route, fileURL);
-      // read file
-      FILE *file = fopen(fileURL, "r");
+  // everything the handlers send goes into the response buffer
+  responseFile = open_memstream(response, responseLen);
 
-      if (file)
-      {
-        // generate HTTP response header
-        char resHeader[SIZE];
+  // switch to a catalog reloaded after an import; nothing else holds the old one
+  Catalog *fresh = __atomic_exchange_n(&freshCatalog, NULL, __ATOMIC_ACQUIRE);
+  if (fresh)
+  {
+    catalogFree(catalog);
+    free(catalog);
+    catalog = fresh;
+    printf("Switched to reloaded catalog\n");
+  }
+  Pages *freshRendered = __atomic_exchange_n(&freshPages, NULL, __ATOMIC_ACQUIRE);
+  if (freshRendered)
+  {
+    pagesFree(pages);
+    free(pages);
+    pages = freshRendered;
+  }
 
-        // get current time
-        char timeBuf[100];
-        getTimeString(timeBuf);
+  // parse HTTP request
+  sscanf(request, "%9s %8191s", method, route); // REQUEST_SIZE - 1
+  printf("%s %s", method, route);
 
-        // generate mime type from file URL
-        char mimeType[32];
-        getMimeType(fileURL, mimeType);
+  // only support GET method
+  if (strcmp(method, "GET") != 0)
+  {
+    const char badRequest[] = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+    fwrite(badRequest, 1, sizeof(badRequest) - 1, responseFile);
+  }
+  else if (routeQuery(route, "/plan"))
+  {
+    handlePlan(routeQuery(route, "/plan"));
+  }
+  else if (routeQuery(route, "/suggest"))
+  {
+    handleSuggest(routeQuery(route, "/suggest"));
+  }
+  else if (routeQuery(route, "/similar"))
+  {
+    handleSimilar(routeQuery(route, "/similar"));
+  }
+  else
+  {
+    char fileURL[REQUEST_SIZE + 32];
 
-        sprintf(resHeader, "HTTP/1.1 200 OK\r\nDate: %s\r\nContent-Type: %s\r\n\n", timeBuf, mimeType);
-        int headerSize = strlen(resHeader);
+    // generate file URL
+    getFileURL(route, fileURL);
+    // rendered pages are served from memory, everything else from htdocs
+    const Page *page = pagesFind(pages, strncmp(fileURL, "htdocs/", 7) == 0 ? fileURL + 7 : fileURL);
+    FILE *file = page ? NULL : fopen(fileURL, "r");
 
-        printf(" %s", mimeType);
+    if (page || file)
+    {
+      // generate HTTP response header
+      char resHeader[SIZE];
 
-        // Calculate file size
+      // get current time
+      char timeBuf[100];
+      getTimeString(timeBuf);
+
+      // generate mime type from file URL
+      char mimeType[32];
+      getMimeType(fileURL, mimeType);
+
+      // Calculate file size
+      long fsize = page ? (long)page->len : 0;
+      if (file)
+      {
         fseek(file, 0, SEEK_END);
-        long fsize = ftell(file);
+        fsize = ftell(file);
         fseek(file, 0, SEEK_SET);
+      }
 
-        // Allocates memory for response buffer and copies response header and file contents to it
-        char *resBuffer = (char *)malloc(fsize + headerSize);
-        strcpy(resBuffer, resHeader);
+      sprintf(resHeader, "HTTP/1.1 200 OK\r\nDate: %s\r\nContent-Type: %s\r\nContent-Length: %ld\r\n\r\n",
+              timeBuf, mimeType, fsize);
+      fputs(resHeader, responseFile);
 
-        // Starting position of file contents in response buffer
-        char *fileBuffer = resBuffer + headerSize;
-        fread(fileBuffer, fsize, 1, file);
+      printf(" %s", mimeType);
 
-        send(clientSocket, resBuffer, fsize + headerSize, 0);
-        free(resBuffer);
-        fclose(file);
+      // Copies file contents after the response header
+      if (page)
+      {
+        fwrite(page->body, 1, page->len, responseFile);
       }
       else
       {
-        const char response[] = "HTTP/1.1 404 Not Found\r\n\n";
-        send(clientSocket, response, sizeof(response), 0);
+        char fileBuffer[SIZE * 8];
+        size_t chunk;
+        while ((chunk = fread(fileBuffer, 1, sizeof(fileBuffer), file)) > 0)
+        {
+          fwrite(fileBuffer, 1, chunk, responseFile);
+        }
+        fclose(file);
       }
     }
-    close(clientSocket);
-    printf("\n");
+    else
+    {
+      const char notFound[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+      fwrite(notFound, 1, sizeof(notFound) - 1, responseFile);
+    }
+  }
+  printf("\n");
+
+  fclose(responseFile);
+  responseFile = NULL;
+}
+
+int isQueryRequest(const char *request)
+{
+  // static files are requested without a query string
+  const char *route = strchr(request, ' ');
+  if (route == NULL)
+  {
+    return 0;
+  }
+  route++;
+  // typeahead sends a request per keystroke and costs a few microseconds
+  if (strncmp(route, "/suggest", 8) == 0 && strchr("? \r\n", route[8]))
+  {
+    return 0;
   }
+  const char *end = strpbrk(route, " \r\n");
+  const char *question = memchr(route, '?', end ? (size_t)(end - route) : strlen(route));
+  return question != NULL || strncmp(route, "/plan", 5) == 0 || strncmp(route, "/similar", 8) == 0;
+}
+
+void printUsage(void)
+{
+  fprintf(stderr, "Usage: server [--backlog N] [--max-connections N] [--max-queries N]\n"
+                  "              [--rate REQUESTS_PER_SECOND] [--burst REQUESTS]\n"
+                  "              [--header-timeout S] [--body-timeout S]\n"
+                  "              [--write-timeout S] [--idle-timeout S]\n"
+                  "              [--backend epoll|io_uring]\n"
+                  "       server --import table=file ...\n"
+                  "       server --snapshot\n");
 }
 
 void getFileURL(char *route, char *fileURL)
@@ -191,8 +474,15 @@ void getFileURL(char *route, char *fileURL)
     CallbackData callbackData;
     callbackData.color = 1;
     callbackData.selected = 1;
+    callbackData.facets = NULL;
+    callbackData.params = NULL;
+    callbackData.paramCount = 0;
     char *ascend_descend = NULL;
     int sort = 0;
+    int facets = 0;
+    CatalogFilter facetFilter;
+    memset(&facetFilter, 0, sizeof(facetFilter));
+    const char *nameTerm = NULL;
     
     if (strstr(route, "addSelected"))
     {
@@ -222,304 +512,210 @@ void getFileURL(char *route, char *fileURL)
         int fac = 0;
         int degree = 0;
         int semester = 0;
-        char sqlQueryString[SIZE] = "SELECT id,Code,Course,Semester,Credits,Faculty,Studylevel,8 FROM courses WHERE";
-        char *parameters = question + 1; // Skip the '?'
-        char *pair = strtok(parameters, "&");
-        while (pair != NULL) {
-            char key[25];
+        char sqlQueryString[4 * SIZE] = "SELECT id,Code,Course,Semester,Credits,Faculty,Studylevel,8 FROM courses WHERE";
+        size_t sqlLen = strlen(sqlQueryString);
+
+        // values are decoded in place and bound to the ? of their condition
+        int paramMax = 1;
+        for (char *amp = question; (amp = strchr(amp + 1, '&')) != NULL;)
+        {
+            paramMax++;
+        }
+        const char **params = (const char **)malloc(sizeof(char *) * paramMax);
+        int paramCount = 0;
+        if (params == NULL)
+        {
+            printf("Not enough memory!\n");
+        }
+
+        char *cursor = question + 1; // Skip the '?'
+        char *key, *decoded;
+        while (params && nextQueryParam(&cursor, &key, &decoded)) {
             int and = 0;
-            strcpy(key, pair);
-            for (long unsigned int i = 0; i < strlen(key); i++)
+            const char *value = decoded;
+            const char *condition = NULL; // appended to the query with value bound to its ?
+
+            if (strcmp(key, "fac") == 0)
             {
-                if (key[i] == '=')
-                {
-                    key[i] = '\0';
-                }
+                value = facultyName(value);
             }
-            char value[64];
-            char *tempValue = strrchr(pair, '=') + 1;
-            strcpy(value, tempValue);
-            if (strrchr(value, '\'') || strrchr(value, '%'))
+
+            // keep the filters for the facet counts
+            int dim = queryDimension(key);
+            if (dim >= 0)
             {
-                fprintf(stderr, "Error! invalid query string\n");
-                break;
+                catalogFilterAdd(&facetFilter, dim, value);
             }
-            int valueLen = strlen(value);
-            for (int i = 0; i < valueLen + 1; i++)
+            else if (strcmp(key, "cname") == 0)
             {
-                if (value[i] == '+')
-                {
-                    value[i] = ' ';
-                }
+                nameTerm = value;
             }
-            
-            //printf("Key: %s and Value: %s\n", key, value);
-            int queryLen = strlen(sqlQueryString) + 1;
-            char tempSqlString[queryLen];
-            for (int i = 0; i < queryLen; i++)
+
+            if (strcmp(key, "sort") == 0) 
             {
-                tempSqlString[i] = sqlQueryString[i];
-                if (sqlQueryString[i] == '\0')
-                {
-                    break;
-                }
-            }
-            if (tempValue) {
-                
-                if (strcmp(key, "fac") == 0)
-                {
-                    if (strcmp(value, "Mari") == 0)
-                    {
-                        strcpy(value, "Estonian Maritime Academy");
-                    }
-                    else if (strcmp(value, "Busi") == 0)
-                    {
-                        strcpy(value, "School of Business and Governance");
-                    }
-                    else if (strcmp(value, "Engi") == 0)
-                    {
-                        strcpy(value, "School of Engineering");
-                    }
-                    else if (strcmp(value, "Infor") == 0)
-                    {
-                        strcpy(value, "School of Information Technologies");
-                    }
-                    else if (strcmp(value, "Scien") == 0)
-                    {
-                        strcpy(value, "School of Science");
-                    }
-                    
-                    
-                    else if (strcmp(value, "AplM") == 0)
-                    {
-                        strcpy(value, "Department of Applied Mathematics and Computer Science");
-                    }
-                    else if (strcmp(value, "Phys") == 0)
-                    {
-                        strcpy(value, "Department of Physics");
-                    }
-                    else if (strcmp(value, "Envir") == 0)
-                    {
-                        strcpy(value, "Department of Environmental and Resource Engineering");
-                    }
-                    else if (strcmp(value, "Healt") == 0)
-                    {
-                        strcpy(value, "Department of Health Technology");
-                    }
-                    else if (strcmp(value, "Food") == 0)
-                    {
-                        strcpy(value, "National Food Institute");
-                    }
-                    else if (strcmp(value, "Aqua") == 0)
-                    {
-                        strcpy(value, "National Institute of Aquatic Resources");
-                    }
-                    else if (strcmp(value, "Chem") == 0)
-                    {
-                        strcpy(value, "Department of Chemistry");
-                    }
-                    else if (strcmp(value, "Bio") == 0)
-                    {
-                        strcpy(value, "Department of Biotechnology and Biomedicine");
-                    }
-                    else if (strcmp(value, "Chemical") == 0)
-                    {
-                        strcpy(value, "Department of Chemical Engineering");
-                    }
-                    else if (strcmp(value, "Biosus") == 0)
-                    {
-                        strcpy(value, "DTU Biosustain");
-                    }
-                    else if (strcmp(value, "Space") == 0)
-                    {
-                        strcpy(value, "National Space Institute");
-                    }
-                    else if (strcmp(value, "Elect") == 0)
-                    {
-                        strcpy(value, "Department of Electrical and Photonics Engineering");
-                    }
-                    else if (strcmp(value, "Mech") == 0)
-                    {
-                        strcpy(value, "Department of Civil and Mechanical Engineering");
-                    }
-                    else if (strcmp(value, "Manag") == 0)
-                    {
-                        strcpy(value, "Department of Technology Management and Economics");
-                    }
-                    else if (strcmp(value, "Wind") == 0)
-                    {
-                        strcpy(value, "Department of Wind and Energy Systems");
-                    }
-                    else if (strcmp(value, "Conver") == 0)
-                    {
-                        strcpy(value, "Department of Energy Conversion and Storage");
-                    }
-                    else if (strcmp(value, "Didac") == 0)
-                    {
-                        strcpy(value, "Department of Engineering Technology and Didactics");
-                    }
-                    else if (strcmp(value, "OtherC") == 0)
-                    {
-                        strcpy(value, "Other courses");
-                    }
-                    
-                }
-                if (strcmp(key, "sort") == 0) 
-                {
-                    sort = atoi(value);
-                } 
-                else if (strcmp(key, "ascend_descend") == 0) 
-                {
-                    if (strcmp(value, "descending") == 0)
-                    {
-                        ascend_descend = "DESC";
-                    }
-                    else 
-                    {
-                        ascend_descend = "ASC";
-                    }
-                } 
-                else if (first == 1)
-                {
-                    first = 0;
-                }
-                else
-                {
-                    and = 1;
-                }
-                
-                
-                if (strcmp(key, "fac") == 0 && fac == 1) 
-                {
-                    sprintf(sqlQueryString, "%s or Faculty = '%s'", tempSqlString, value);
-                    fac = 1;
-                }
-                else if (strcmp(key, "fac") == 0 && and == 1) 
-                {
-                    sprintf(sqlQueryString, "%s and Faculty = '%s'", tempSqlString, value);
-                    fac = 1;
-                }
-                else if (strcmp(key, "fac") == 0) 
-                {
-                    sprintf(sqlQueryString, "%s Faculty = '%s'", tempSqlString, value);
-                    fac = 1;
-                }
-                
-                else if (strcmp(key, "degree") == 0 && degree == 1) 
-                {
-                    sprintf(sqlQueryString, "%s or Studylevel like '%%%s%%'", tempSqlString, value);
-                    degree = 1;
-                } 
-                else if (strcmp(key, "degree") == 0 && and == 1) 
-                {
-                    sprintf(sqlQueryString, "%s and Studylevel like '%%%s%%'", tempSqlString, value);
-                    degree = 1;
-                } 
-                else if (strcmp(key, "degree") == 0) 
-                {
-                    sprintf(sqlQueryString, "%s Studylevel like '%%%s%%'", tempSqlString, value);
-                    degree = 1;
-                } 
-                
-                else if (strcmp(key, "semester") == 0 && semester == 1) 
-                {
-                    sprintf(sqlQueryString, "%s or Semester like '%%%s%%'", tempSqlString, value);
-                    semester = 1;
-                } 
-                else if (strcmp(key, "semester") == 0 && and == 1) 
-                {
-                    sprintf(sqlQueryString, "%s and Semester like '%%%s%%'", tempSqlString, value);
-                    semester = 1;
-                } 
-                else if (strcmp(key, "semester") == 0) 
-                {
-                    sprintf(sqlQueryString, "%s Semester like '%%%s%%'", tempSqlString, value);
-                    semester = 1;
-                } 
-                
-                else if (strcmp(key, "uni") == 0 && uni == 1) 
-                {
-                    sprintf(sqlQueryString, "%s or University = '%s'", tempSqlString, value);
-                    uni = 1;
-                }
-                else if (strcmp(key, "uni") == 0 && and == 1) 
-                {
-                    sprintf(sqlQueryString, "%s and University = '%s'", tempSqlString, value);
-                    uni = 1;
-                }
-                else if (strcmp(key, "uni") == 0) 
-                {
-                    sprintf(sqlQueryString, "%s University = '%s'", tempSqlString, value);
-                    uni = 1;
-                }
-                
-                else if (strcmp(key, "cname") == 0 && and == 1)
-                {
-                    sprintf(sqlQueryString, "%s and Course like '%%%s%%'", tempSqlString, value);
-                }
-                else if (strcmp(key, "cname") == 0)
+                sort = atoi(value);
+            } 
+            else if (strcmp(key, "ascend_descend") == 0) 
+            {
+                if (strcmp(value, "descending") == 0)
                 {
-                    sprintf(sqlQueryString, "%s Course like '%%%s%%'", tempSqlString, value);
+                    ascend_descend = "DESC";
                 }
-                else if (strcmp(key, "choice") == 0)
+                else 
                 {
-                    if (choicesNum + 1 >= choicesMem)
-                    {
-                        choicesMem = choicesArr(choicesMem, choices);
-                    }
-
-                    int *pChoice = choices + choicesNum;
-                    *pChoice = atoi(value);
-                    choicesNum++;
+                    ascend_descend = "ASC";
                 }
-                else if (strcmp(key, "selected") == 0)
+            } 
+            else if (strcmp(key, "facets") == 0)
+            {
+                facets = 1;
+            }
+            else if (first == 1)
+            {
+                first = 0;
+            }
+            else
+            {
+                and = 1;
+            }
+            
+            
+            if (strcmp(key, "fac") == 0 && fac == 1) 
+            {
+                condition = " or Faculty = ?";
+            }
+            else if (strcmp(key, "fac") == 0 && and == 1) 
+            {
+                condition = " and Faculty = ?";
+                fac = 1;
+            }
+            else if (strcmp(key, "fac") == 0) 
+            {
+                condition = " Faculty = ?";
+                fac = 1;
+            }
+            
+            else if (strcmp(key, "degree") == 0 && degree == 1) 
+            {
+                condition = " or Studylevel like '%' || ? || '%'";
+            } 
+            else if (strcmp(key, "degree") == 0 && and == 1) 
+            {
+                condition = " and Studylevel like '%' || ? || '%'";
+                degree = 1;
+            } 
+            else if (strcmp(key, "degree") == 0) 
+            {
+                condition = " Studylevel like '%' || ? || '%'";
+                degree = 1;
+            } 
+            
+            else if (strcmp(key, "semester") == 0 && semester == 1) 
+            {
+                condition = " or Semester like '%' || ? || '%'";
+            } 
+            else if (strcmp(key, "semester") == 0 && and == 1) 
+            {
+                condition = " and Semester like '%' || ? || '%'";
+                semester = 1;
+            } 
+            else if (strcmp(key, "semester") == 0) 
+            {
+                condition = " Semester like '%' || ? || '%'";
+                semester = 1;
+            } 
+            
+            else if (strcmp(key, "uni") == 0 && uni == 1) 
+            {
+                condition = " or University = ?";
+            }
+            else if (strcmp(key, "uni") == 0 && and == 1) 
+            {
+                condition = " and University = ?";
+                uni = 1;
+            }
+            else if (strcmp(key, "uni") == 0) 
+            {
+                condition = " University = ?";
+                uni = 1;
+            }
+            
+            else if (strcmp(key, "cname") == 0 && and == 1)
+            {
+                condition = " and Course like '%' || ? || '%'";
+            }
+            else if (strcmp(key, "cname") == 0)
+            {
+                condition = " Course like '%' || ? || '%'";
+            }
+            else if (strcmp(key, "choice") == 0)
+            {
+                if (choicesNum + 1 >= choicesMem)
                 {
-                    printf("selected = 2\n");
-                    callbackData.selected = 2;
+                    choicesMem = choicesArr(choicesMem, choices);
                 }
-                
+
+                int *pChoice = choices + choicesNum;
+                *pChoice = atoi(value);
+                choicesNum++;
             }
-            pair = strtok(NULL, "&");
-        }
-        int queryLen = strlen(sqlQueryString) + 1;
-        char tempSqlString[queryLen];
-        for (int i = 0; i < queryLen; i++)
-        {
-            tempSqlString[i] = sqlQueryString[i];
-            if (sqlQueryString[i] == '\0')
+            else if (strcmp(key, "selected") == 0)
             {
-                break;
+                printf("selected = 2\n");
+                callbackData.selected = 2;
+            }
+
+            if (condition)
+            {
+                // keep room for the University default and ORDER BY
+                size_t len = strlen(condition);
+                if (sqlLen + len + 64 >= sizeof(sqlQueryString))
+                {
+                    fprintf(stderr, "Error! query string too long\n");
+                    break;
+                }
+                memcpy(sqlQueryString + sqlLen, condition, len + 1);
+                sqlLen += len;
+                params[paramCount++] = value;
             }
         }
-        if (strstr(tempSqlString, "University") == NULL && first == 0)
-        {
-            sprintf(sqlQueryString, "%s and University = '%s'", tempSqlString, "CTU");
-        }
-        else if (strstr(tempSqlString, "University") == NULL && first == 1)
+        if (uni == 0 && first == 0)
         {
-            sprintf(sqlQueryString, "%s University = '%s'", tempSqlString, "CTU");
+            sqlLen += snprintf(sqlQueryString + sqlLen, sizeof(sqlQueryString) - sqlLen,
+                               " and University = '%s'", "CTU");
         }
-        
-        
-        int queryLen2 = strlen(sqlQueryString) + 1;
-        char tempSqlString2[queryLen2];
-        for (int i = 0; i < queryLen2; i++)
+        else if (uni == 0 && first == 1)
         {
-            tempSqlString2[i] = sqlQueryString[i];
-            if (sqlQueryString[i] == '\0')
-            {
-                break;
-            }
+            sqlLen += snprintf(sqlQueryString + sqlLen, sizeof(sqlQueryString) - sqlLen,
+                               " University = '%s'", "CTU");
         }
         if (sort != 0 && ascend_descend != NULL)
         {
-            sprintf(sqlQueryString, "%s ORDER BY %d %s", tempSqlString2, sort, ascend_descend);
+            snprintf(sqlQueryString + sqlLen, sizeof(sqlQueryString) - sqlLen, " ORDER BY %d %s",
+                     sort, ascend_descend);
         }
         else if (sort != 0)
         {
-            sprintf(sqlQueryString, "%s ORDER BY %d", tempSqlString2, sort);
+            snprintf(sqlQueryString + sqlLen, sizeof(sqlQueryString) - sqlLen, " ORDER BY %d", sort);
         }
+        callbackData.params = params;
+        callbackData.paramCount = paramCount;
         
+        if (callbackData.selected == 1 && facets)
+        {
+            // counts of every facet in one pass over the in-memory catalog
+            uint32_t counts[CATALOG_DIMS][CATALOG_MAX_VALUES];
+            size_t facetsSize;
+            if (facetFilter.termCount[DIM_UNI] == 0)
+            {
+                catalogFilterAdd(&facetFilter, DIM_UNI, "CTU");
+            }
+            uint32_t total = catalogFacetCounts(catalog, &facetFilter, nameTerm, counts);
+            FILE *facetsFile = open_memstream(&callbackData.facets, &facetsSize);
+            writeFacets(facetsFile, counts, total);
+            fclose(facetsFile);
+        }
+
         if (callbackData.selected == 1)
         {
             //SQL QUERY CALL
@@ -529,6 +725,7 @@ void getFileURL(char *route, char *fileURL)
             fprintf(stderr, "Closed database successfully\n");
             fclose(callbackData.fp);
             fprintf(stderr, "Closed output.html successfully\n");
+            free(callbackData.facets);
         }
         else if (callbackData.selected == 2)
         {
@@ -545,6 +742,7 @@ void getFileURL(char *route, char *fileURL)
             fprintf(stderr, "Closed database successfully\n");
         }
         free(choices);
+        free(params);
         *question = '\0'; // Remove parameters by replacing '?' with '\0'
         
     }
@@ -571,6 +769,50 @@ void getFileURL(char *route, char *fileURL)
     }
 }
 
+// short codes used by the faculty checkboxes of the university pages
+static const struct
+{
+    const char *code;
+    const char *name;
+} facultyCodes[] = {
+    {"Mari", "Estonian Maritime Academy"},
+    {"Busi", "School of Business and Governance"},
+    {"Engi", "School of Engineering"},
+    {"Infor", "School of Information Technologies"},
+    {"Scien", "School of Science"},
+
+    {"AplM", "Department of Applied Mathematics and Computer Science"},
+    {"Phys", "Department of Physics"},
+    {"Envir", "Department of Environmental and Resource Engineering"},
+    {"Healt", "Department of Health Technology"},
+    {"Food", "National Food Institute"},
+    {"Aqua", "National Institute of Aquatic Resources"},
+    {"Chem", "Department of Chemistry"},
+    {"Bio", "Department of Biotechnology and Biomedicine"},
+    {"Chemical", "Department of Chemical Engineering"},
+    {"Biosus", "DTU Biosustain"},
+    {"Space", "National Space Institute"},
+    {"Elect", "Department of Electrical and Photonics Engineering"},
+    {"Mech", "Department of Civil and Mechanical Engineering"},
+    {"Manag", "Department of Technology Management and Economics"},
+    {"Wind", "Department of Wind and Energy Systems"},
+    {"Conver", "Department of Energy Conversion and Storage"},
+    {"Didac", "Department of Engineering Technology and Didactics"},
+    {"OtherC", "Other courses"},
+};
+
+const char *facultyName(const char *value)
+{
+    for (size_t i = 0; i < sizeof(facultyCodes) / sizeof(facultyCodes[0]); i++)
+    {
+        if (strcmp(value, facultyCodes[i].code) == 0)
+        {
+            return facultyCodes[i].name;
+        }
+    }
+    return value;
+}
+
 void getMimeType(char *file, char *mime)
 {
   // position in string with period character
@@ -608,12 +850,8 @@ void handleSignal(int signal)
   {
     printf("\nShutting down server...\n");
 
-    close(clientSocket);
     close(serverSocket);
 
-    if (request != NULL)
-      free(request);
-
     exit(0);
   }
 }
@@ -632,6 +870,7 @@ void sqlQuery(const char *data, FILE *fGiven, sqlite3 *dbGiven, CallbackData *db
     char *zErrMsg = 0;
     int rc;
     char sql[SIZE];
+    const char *statement = sql; // a search statement is run as given, it may be longer than sql
     FILE *fp;
     CallbackData *callbackData = dbData;
     callbackData->subMap = 0;
@@ -643,7 +882,7 @@ void sqlQuery(const char *data, FILE *fGiven, sqlite3 *dbGiven, CallbackData *db
     }
     else
     {
-        rc = sqlite3_open("euroteq.db", &db);
+        rc = sqlite3_open(DATABASE, &db);
         
         if( rc ) {
             fprintf(stderr, "Can't open database: %s\n", sqlite3_errmsg(db));
@@ -709,7 +948,7 @@ void sqlQuery(const char *data, FILE *fGiven, sqlite3 *dbGiven, CallbackData *db
     }
     else if (strstr(data, "SELECT"))
     {
-        strcpy(sql, data);
+        statement = data;
     }
     else if (strstr(data, "=fnSubMap"))
     {
@@ -742,6 +981,10 @@ void sqlQuery(const char *data, FILE *fGiven, sqlite3 *dbGiven, CallbackData *db
         fprintf(fp, "<html>\n<head>\n<link href=\"styles/styleOutput.css\" "
                     "rel=\"stylesheet\" type=\"text/css\" />"
                     "\n</head>\n<body>\n");
+        if (callbackData->facets)
+        {
+            fputs(callbackData->facets, fp);
+        }
         
         fprintf(fp, "<form action=\"selection\" method=\"get\">\n"
                     "<input type=\"submit\" name=\"addSelected\" value=\"Add Selected\">\n"
@@ -762,11 +1005,13 @@ void sqlQuery(const char *data, FILE *fGiven, sqlite3 *dbGiven, CallbackData *db
     
     
     /* Execute SQL statement */
-    rc = sqlite3_exec(db, sql, callback, (void*)callbackData, &zErrMsg);
+    const char **params = callbackData->params;
+    int paramCount = callbackData->paramCount;
+    callbackData->paramCount = 0; // the subjectmap lookups of the callback bind nothing
+    rc = sqlExecBound(db, statement, params, paramCount, callbackData);
    
     if( rc != SQLITE_OK ) {
-        fprintf(stderr, "SQL error: %s\n", zErrMsg);
-        sqlite3_free(zErrMsg);
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
     } else {
         //fprintf(stdout, "Operation done successfully\n");
     }
@@ -784,6 +1029,33 @@ void sqlQuery(const char *data, FILE *fGiven, sqlite3 *dbGiven, CallbackData *db
 }
 
 
+static int sqlExecBound(sqlite3 *db, const char *sql, const char **params, int paramCount, CallbackData *data)
+{
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK)
+    {
+        return rc;
+    }
+    for (int i = 0; i < paramCount; i++)
+    {
+        sqlite3_bind_text(stmt, i + 1, params[i], -1, SQLITE_STATIC);
+    }
+
+    int columns = sqlite3_column_count(stmt);
+    char *values[columns + 1];
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        for (int i = 0; i < columns; i++)
+        {
+            values[i] = (char *)sqlite3_column_text(stmt, i);
+        }
+        callback(data, columns, values, NULL);
+    }
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE ? SQLITE_OK : rc;
+}
+
 static int callback(void *data, int argc, char **argv, char **NotUsed)
 {
     int i;
@@ -877,3 +1149,474 @@ int choicesArr(int n, int *choices)
     }
     return newLimit;
 }
+
+// query keys of the search forms, in catalog dimension order
+static const char *dimensionKeys[CATALOG_DIMS] = {"uni", "fac", "degree", "semester"};
+static const char *dimensionLabels[CATALOG_DIMS] = {"University", "Faculty", "Study level", "Semester"};
+
+int queryDimension(const char *key)
+{
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        if (strcmp(key, dimensionKeys[dim]) == 0)
+        {
+            return dim;
+        }
+    }
+    return -1;
+}
+
+void writeFacets(FILE *fp, uint32_t counts[CATALOG_DIMS][CATALOG_MAX_VALUES], uint32_t total)
+{
+    fprintf(fp, "<div class=\"facets\">\n<p>Matching courses: %u</p>\n", total);
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        fprintf(fp, "<p>%s:", dimensionLabels[dim]);
+        int listed = 0;
+        for (uint32_t o = 0; o < catalog->optionCount[dim]; o++)
+        {
+            if (counts[dim][o])
+            {
+                fprintf(fp, "%s %s (%u)", listed++ ? "," : "",
+                        catalogString(catalog, catalog->options[dim][o]), counts[dim][o]);
+            }
+        }
+        fprintf(fp, "</p>\n");
+    }
+    fprintf(fp, "</div>\n");
+}
+
+void urlDecode(char *s)
+{
+    char *out = s;
+    while (*s)
+    {
+        if (*s == '+')
+        {
+            *out++ = ' ';
+            s++;
+        }
+        else if (*s == '%' && isxdigit((unsigned char)s[1]) && isxdigit((unsigned char)s[2]))
+        {
+            char hex[3] = {s[1], s[2], '\0'};
+            *out++ = (char)strtol(hex, NULL, 16);
+            s += 3;
+        }
+        else
+        {
+            *out++ = *s++;
+        }
+    }
+    *out = '\0';
+}
+
+int nextQueryParam(char **cursor, char **key, char **value)
+{
+    char *pair = *cursor;
+    if (pair == NULL || *pair == '\0')
+    {
+        return 0;
+    }
+
+    char *end = strchr(pair, '&');
+    if (end)
+    {
+        *end = '\0';
+        *cursor = end + 1;
+    }
+    else
+    {
+        *cursor = pair + strlen(pair);
+    }
+
+    char *equals = strchr(pair, '=');
+    if (equals)
+    {
+        *equals = '\0';
+    }
+    *key = pair;
+    *value = equals ? equals + 1 : pair + strlen(pair);
+
+    urlDecode(*key);
+    urlDecode(*value);
+    return 1;
+}
+
+void sendResponse(const char *status, const char *mime, const char *body, size_t len)
+{
+    char timeBuf[100];
+    getTimeString(timeBuf);
+
+    fprintf(responseFile, "HTTP/1.1 %s\r\nDate: %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n\r\n",
+            status, timeBuf, mime, len);
+    fwrite(body, 1, len, responseFile);
+}
+
+void writeJsonString(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+    for (; *s; s++)
+    {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\')
+        {
+            fprintf(fp, "\\%c", c);
+        }
+        else if (c < 0x20)
+        {
+            fprintf(fp, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+void handlePlan(char *query)
+{
+    CatalogFilter filter;
+    PlanQuery planQuery;
+    PlanResult result;
+    uint32_t include[PLAN_MAX_COURSES];
+    char *key, *value;
+    const char *error = NULL;
+
+    memset(&filter, 0, sizeof(filter));
+    memset(&planQuery, 0, sizeof(planQuery));
+    planQuery.maxCredits = 30;
+    planQuery.topK = 5;
+    planQuery.maxCourses = 8;
+    planQuery.budgetMs = PLAN_BUDGET_MS;
+    planQuery.include = include;
+
+    while (nextQueryParam(&query, &key, &value))
+    {
+        if (strcmp(key, "min") == 0)
+        {
+            planQuery.minCredits = atoi(value);
+        }
+        else if (strcmp(key, "max") == 0)
+        {
+            planQuery.maxCredits = atoi(value);
+        }
+        else if (strcmp(key, "k") == 0)
+        {
+            planQuery.topK = atoi(value);
+        }
+        else if (strcmp(key, "maxcourses") == 0)
+        {
+            planQuery.maxCourses = atoi(value);
+        }
+        else if (strcmp(key, "budget") == 0)
+        {
+            // the search runs on the event loop, so a client may only shorten it
+            planQuery.budgetMs = atoi(value);
+            if (planQuery.budgetMs < 1)
+            {
+                planQuery.budgetMs = 1;
+            }
+            else if (planQuery.budgetMs > PLAN_BUDGET_MS)
+            {
+                planQuery.budgetMs = PLAN_BUDGET_MS;
+            }
+        }
+        else if (queryDimension(key) == DIM_FAC)
+        {
+            catalogFilterAdd(&filter, DIM_FAC, facultyName(value));
+        }
+        else if (queryDimension(key) >= 0)
+        {
+            catalogFilterAdd(&filter, queryDimension(key), value);
+        }
+        else if (strcmp(key, "include") == 0)
+        {
+            int idx = catalogFind(catalog, atoi(value));
+            if (idx < 0)
+            {
+                error = "unknown course id in include";
+            }
+            else if (planQuery.includeCount == PLAN_MAX_COURSES)
+            {
+                error = "too many included courses";
+            }
+            else
+            {
+                include[planQuery.includeCount++] = idx;
+            }
+        }
+    }
+
+    uint64_t *allowed = malloc(catalog->bitsetWords * sizeof(uint64_t) * 2 + 1);
+    if (allowed == NULL)
+    {
+        printf("Not enough memory!\n");
+        const char response[] = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+        fwrite(response, 1, sizeof(response) - 1, responseFile);
+        return;
+    }
+    catalogFilterBits(catalog, &filter, -1, allowed, allowed + catalog->bitsetWords);
+    planQuery.allowed = allowed;
+
+    if (error == NULL && planSearch(catalog, &planQuery, &result) < 0)
+    {
+        error = "invalid credit range, k, maxcourses or include";
+    }
+    free(allowed);
+
+    char *body;
+    size_t bodySize;
+    FILE *fp = open_memstream(&body, &bodySize);
+    if (error)
+    {
+        fprintf(fp, "{\"error\":");
+        writeJsonString(fp, error);
+        fprintf(fp, "}");
+        fclose(fp);
+        sendResponse("400 Bad Request", "application/json", body, bodySize);
+        free(body);
+        return;
+    }
+
+    fprintf(fp, "{\"complete\":%s,\"nodes\":%ld,\"plans\":[",
+            result.complete ? "true" : "false", result.nodes);
+    for (int i = 0; i < result.count; i++)
+    {
+        Plan *plan = &result.plans[i];
+        fprintf(fp, "%s{\"credits\":%d,\"courses\":[", i ? "," : "", plan->credits);
+        for (int j = 0; j < plan->count; j++)
+        {
+            const CatalogCourse *c = &catalog->courses[plan->courses[j]];
+            fprintf(fp, "%s{\"id\":%u,\"code\":", j ? "," : "", c->id);
+            writeJsonString(fp, catalogString(catalog, c->code));
+            fprintf(fp, ",\"course\":");
+            writeJsonString(fp, catalogString(catalog, c->course));
+            fprintf(fp, ",\"credits\":%d,\"university\":", c->credits);
+            writeJsonString(fp, catalogString(catalog, catalog->values[DIM_UNI][c->value[DIM_UNI]]));
+            fprintf(fp, ",\"faculty\":");
+            writeJsonString(fp, catalogString(catalog, catalog->values[DIM_FAC][c->value[DIM_FAC]]));
+            fprintf(fp, "}");
+        }
+        fprintf(fp, "]}");
+    }
+    fprintf(fp, "]}");
+    fclose(fp);
+
+    printf(" %d plans, %ld nodes", result.count, result.nodes);
+    sendResponse("200 OK", "application/json", body, bodySize);
+    free(body);
+}
+
+char *routeQuery(char *route, const char *path)
+{
+    size_t len = strlen(path);
+    if (strncmp(route, path, len) != 0)
+    {
+        return NULL;
+    }
+    if (route[len] == '?')
+    {
+        return route + len + 1;
+    }
+    return route[len] == '\0' ? route + len : NULL;
+}
+
+void handleSuggest(char *query)
+{
+    CatalogFilter filter;
+    uint32_t found[SUGGEST_MAX];
+    const char *prefix = "";
+    int k = 8;
+    char *key, *value;
+
+    memset(&filter, 0, sizeof(filter));
+    while (nextQueryParam(&query, &key, &value))
+    {
+        if (strcmp(key, "q") == 0)
+        {
+            prefix = value;
+        }
+        else if (strcmp(key, "k") == 0)
+        {
+            k = atoi(value);
+            if (k < 1)
+            {
+                k = 1;
+            }
+            else if (k > SUGGEST_MAX)
+            {
+                k = SUGGEST_MAX;
+            }
+        }
+        else if (strcmp(key, "uni") == 0)
+        {
+            catalogFilterAdd(&filter, DIM_UNI, value);
+        }
+    }
+
+    uint64_t *allowed = NULL;
+    if (filter.termCount[DIM_UNI])
+    {
+        allowed = calloc(catalog->bitsetWords + 1, sizeof(uint64_t));
+        if (allowed == NULL)
+        {
+            printf("Not enough memory!\n");
+            const char response[] = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+            fwrite(response, 1, sizeof(response) - 1, responseFile);
+            return;
+        }
+        for (int t = 0; t < filter.termCount[DIM_UNI]; t++)
+        {
+            catalogMatchTerm(catalog, DIM_UNI, filter.terms[DIM_UNI][t], allowed);
+        }
+    }
+    int count = catalogSuggest(catalog, prefix, allowed, found, k);
+    free(allowed);
+
+    // compact output: a keystroke should cost a few hundred bytes
+    char *body;
+    size_t bodySize;
+    FILE *fp = open_memstream(&body, &bodySize);
+    fputc('[', fp);
+    for (int i = 0; i < count; i++)
+    {
+        const CatalogCourse *c = &catalog->courses[found[i]];
+        fprintf(fp, "%s{\"id\":%u,\"code\":", i ? "," : "", c->id);
+        writeJsonString(fp, catalogString(catalog, c->code));
+        fprintf(fp, ",\"course\":");
+        writeJsonString(fp, catalogString(catalog, c->course));
+        fputc('}', fp);
+    }
+    fputc(']', fp);
+    fclose(fp);
+
+    sendResponse("200 OK", "application/json", body, bodySize);
+    free(body);
+}
+
+void writeCourseJson(FILE *fp, const CatalogCourse *c)
+{
+    fprintf(fp, "{\"id\":%u,\"code\":", c->id);
+    writeJsonString(fp, catalogString(catalog, c->code));
+    fprintf(fp, ",\"course\":");
+    writeJsonString(fp, catalogString(catalog, c->course));
+    fprintf(fp, ",\"university\":");
+    writeJsonString(fp, catalogString(catalog, catalog->values[DIM_UNI][c->value[DIM_UNI]]));
+}
+
+void handleSimilar(char *query)
+{
+    SimilarMatch found[SIMILAR_MAX_K];
+    int id = -1;
+    int k = SIMILAR_K;
+    char *key, *value;
+
+    while (nextQueryParam(&query, &key, &value))
+    {
+        if (strcmp(key, "id") == 0)
+        {
+            id = atoi(value);
+        }
+        else if (strcmp(key, "k") == 0)
+        {
+            k = atoi(value);
+            if (k < 1)
+            {
+                k = 1;
+            }
+            else if (k > SIMILAR_MAX_K)
+            {
+                k = SIMILAR_MAX_K;
+            }
+        }
+    }
+
+    int course = id < 0 ? -1 : catalogFind(catalog, id);
+    if (course < 0)
+    {
+        const char error[] = "{\"error\":\"unknown course id\"}";
+        sendResponse("404 Not Found", "application/json", error, sizeof(error) - 1);
+        return;
+    }
+    int count = similarFind(catalog, course, found, k);
+    if (count < 0)
+    {
+        const char response[] = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+        fwrite(response, 1, sizeof(response) - 1, responseFile);
+        return;
+    }
+
+    char *body;
+    size_t bodySize;
+    FILE *fp = open_memstream(&body, &bodySize);
+    fprintf(fp, "{\"course\":");
+    writeCourseJson(fp, &catalog->courses[course]);
+    fprintf(fp, "},\"similar\":[");
+    for (int i = 0; i < count; i++)
+    {
+        fputs(i ? "," : "", fp);
+        writeCourseJson(fp, &catalog->courses[found[i].course]);
+        fprintf(fp, ",\"score\":%.3f}", found[i].score);
+    }
+    fprintf(fp, "]}");
+    fclose(fp);
+
+    sendResponse("200 OK", "application/json", body, bodySize);
+    free(body);
+}
+
+void *catalogReloader(void *arg)
+{
+    CatalogSource loaded = *(CatalogSource *)arg;
+    free(arg);
+
+    while (1)
+    {
+        sleep(CATALOG_POLL_SECONDS);
+
+        CatalogSource current;
+        if (__atomic_load_n(&freshCatalog, __ATOMIC_ACQUIRE) != NULL ||
+            catalogSourceStat(DATABASE, &current) < 0 ||
+            memcmp(&current, &loaded, offsetof(CatalogSource, fingerprint)) == 0)
+        {
+            continue;
+        }
+
+        // the file also changes when a selection is saved; only an import changes the catalog tables
+        if (catalogFingerprint(DATABASE, &current.fingerprint) < 0)
+        {
+            continue;
+        }
+        if (current.fingerprint == loaded.fingerprint)
+        {
+            loaded = current;
+            continue;
+        }
+
+        Catalog *next = (Catalog *)malloc(sizeof(Catalog));
+        if (next == NULL || catalogLoad(next, DATABASE) < 0)
+        {
+            // retry once the file changes again
+            fprintf(stderr, "Error: reloading the catalog failed\n");
+            free(next);
+            loaded = current;
+            continue;
+        }
+        loaded = next->source;
+
+        // the import may have added universities or faculties
+        Pages *rendered = (Pages *)malloc(sizeof(Pages));
+        if (rendered == NULL || pagesBuild(rendered, &templates, DATABASE) < 0)
+        {
+            fprintf(stderr, "Error: rebuilding the university pages failed\n");
+            free(rendered);
+        }
+        else
+        {
+            __atomic_store_n(&freshPages, rendered, __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&freshCatalog, next, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
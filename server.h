@@ -0,0 +1,23 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+
+#define REQUEST_SIZE 8192 // largest request head read from a client
+
+/**
+ * @brief Handles one HTTP request and builds the complete response
+ * @param request request head, modified while parsed
+ * @param response set to the malloc'd response bytes
+ * @param responseLen set to the length of the response
+ */
+void handleRequest(char *request, char **response, size_t *responseLen);
+
+/**
+ * @brief Tells whether a request is a search (database or catalog work),
+ * queued behind other searches and charged to the rate of its client IP;
+ * static files and /suggest keystrokes are not
+ */
+int isQueryRequest(const char *request);
+
+#endif
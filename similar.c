@@ -0,0 +1,457 @@
+#define _GNU_SOURCE // strcasestr
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <unistd.h>  // sysconf
+#include <pthread.h>
+
+#include "similar.h"
+
+#define PARALLEL_MIN 8192 // fewer courses are scored on one thread
+#define TOKEN_SIZE 32
+#define TERMS_INITIAL 4096 // slots of the term table, a power of two
+#define META_WEIGHT 0.5f // code, faculty and level count half as much as a name word
+
+// one kernel per instruction set, picked when the program is loaded
+#if defined(__x86_64__) && defined(__GNUC__)
+#define VECTOR_CLONES __attribute__((target_clones("arch=x86-64-v3", "default")))
+#else
+#define VECTOR_CLONES
+#endif
+
+typedef float Vec8 __attribute__((vector_size(32)));
+
+static const char *stopWords[] = {"and", "of", "the", "for", "in", "to", "with", "on", "an", "by", "at", "from"};
+
+/**
+ * @brief Distinct feature of the catalog; kind and token are stored as one key
+ */
+typedef struct {
+    char *key;
+    uint32_t df;         // courses having the term
+    uint32_t lastCourse; // last course counted in df, plus one
+    int column;          // vector dimension, -1 if the term is not used
+} Term;
+
+typedef struct {
+    uint32_t size; // power of two
+    uint32_t count;
+    Term *slots;
+    Term **byDf; // terms ordered by df when assigning columns
+    uint32_t course;
+    float *row; // row being filled, NULL while counting
+    int failed;
+} Terms;
+
+typedef struct {
+    const Catalog *cat;
+    const float *query;
+    uint16_t uni; // value id of the university to skip
+    uint32_t begin;
+    uint32_t end;
+    int k;
+    int count;
+    SimilarMatch best[SIMILAR_MAX_K];
+    pthread_t tid;
+} Worker;
+
+/**
+ * @brief Dot product of two 32-byte aligned vectors of n floats, n a
+ * multiple of 16
+ */
+VECTOR_CLONES
+static float dot(const float *a, const float *b, uint32_t n)
+{
+    const Vec8 *x = (const Vec8 *)a;
+    const Vec8 *y = (const Vec8 *)b;
+    Vec8 sum0 = {0};
+    Vec8 sum1 = {0};
+    for (uint32_t i = 0; i < n / 8; i += 2)
+    {
+        sum0 += x[i] * y[i];
+        sum1 += x[i + 1] * y[i + 1];
+    }
+    sum0 += sum1;
+    return sum0[0] + sum0[1] + sum0[2] + sum0[3] + sum0[4] + sum0[5] + sum0[6] + sum0[7];
+}
+
+static uint32_t termHash(const char *key)
+{
+    uint32_t h = 2166136261u;
+    for (; *key; key++)
+    {
+        h ^= (unsigned char)*key;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static Term *termSlot(Terms *terms, const char *key)
+{
+    uint32_t mask = terms->size - 1;
+    uint32_t i = termHash(key) & mask;
+    while (terms->slots[i].key && strcmp(terms->slots[i].key, key) != 0)
+    {
+        i = (i + 1) & mask;
+    }
+    return &terms->slots[i];
+}
+
+static int termsGrow(Terms *terms)
+{
+    Term *old = terms->slots;
+    uint32_t oldSize = terms->size;
+    terms->size = oldSize ? oldSize * 2 : TERMS_INITIAL;
+    terms->slots = calloc(terms->size, sizeof(Term));
+    if (terms->slots == NULL)
+    {
+        terms->slots = old;
+        terms->size = oldSize;
+        return -1;
+    }
+    for (uint32_t i = 0; i < oldSize; i++)
+    {
+        if (old[i].key)
+        {
+            *termSlot(terms, old[i].key) = old[i];
+        }
+    }
+    free(old);
+    return 0;
+}
+
+/**
+ * @brief Counts the term while terms are collected, adds its weight to the
+ * row of the current course afterwards
+ */
+static void addFeature(Terms *terms, char kind, const char *token, float weight)
+{
+    char key[TOKEN_SIZE + 2];
+    snprintf(key, sizeof(key), "%c:%s", kind, token);
+
+    if (terms->row)
+    {
+        Term *term = termSlot(terms, key);
+        if (term->key && term->column >= 0)
+        {
+            terms->row[term->column] += weight;
+        }
+        return;
+    }
+
+    if (terms->count * 2 >= terms->size && termsGrow(terms) < 0)
+    {
+        terms->failed = 1;
+        return;
+    }
+    Term *term = termSlot(terms, key);
+    if (term->key == NULL)
+    {
+        term->key = strdup(key);
+        if (term->key == NULL)
+        {
+            terms->failed = 1;
+            return;
+        }
+        terms->count++;
+    }
+    if (term->lastCourse != terms->course + 1)
+    {
+        term->lastCourse = terms->course + 1;
+        term->df++;
+    }
+}
+
+static void addWord(Terms *terms, char *word, size_t len)
+{
+    if (len < 2)
+    {
+        return;
+    }
+    for (size_t i = 0; i < sizeof(stopWords) / sizeof(stopWords[0]); i++)
+    {
+        if (strcmp(word, stopWords[i]) == 0)
+        {
+            return;
+        }
+    }
+    // plural and singular count as one word
+    if (len > 4 && word[len - 1] == 's' && word[len - 2] != 's')
+    {
+        word[len - 1] = '\0';
+    }
+    addFeature(terms, 'w', word, 1.0f);
+}
+
+/**
+ * @brief Passes the terms of course i to addFeature
+ */
+static void courseFeatures(const Catalog *cat, uint32_t i, Terms *terms)
+{
+    const CatalogCourse *c = &cat->courses[i];
+    char token[TOKEN_SIZE];
+    size_t len = 0;
+
+    for (const char *s = catalogString(cat, c->course);; s++)
+    {
+        if (isalnum((unsigned char)*s) && len < TOKEN_SIZE - 1)
+        {
+            token[len++] = tolower((unsigned char)*s);
+        }
+        else if (!isalnum((unsigned char)*s))
+        {
+            token[len] = '\0';
+            addWord(terms, token, len);
+            len = 0;
+        }
+        if (*s == '\0')
+        {
+            break;
+        }
+    }
+
+    // letters before the number of a code name the subject area, e.g. TMT in TMT0350
+    const char *code = catalogString(cat, c->code);
+    for (len = 0; isalpha((unsigned char)code[len]) && len < TOKEN_SIZE - 1; len++)
+    {
+        token[len] = toupper((unsigned char)code[len]);
+    }
+    token[len] = '\0';
+    if (len > 0)
+    {
+        addFeature(terms, 'c', token, META_WEIGHT);
+    }
+
+    addFeature(terms, 'f', catalogString(cat, cat->values[DIM_FAC][c->value[DIM_FAC]]), META_WEIGHT);
+
+    // the universities spell levels differently: BEng, Doctoral, Doctorate
+    const char *level = catalogString(cat, cat->values[DIM_DEGREE][c->value[DIM_DEGREE]]);
+    if (strcasestr(level, "bach") || strcasestr(level, "beng") || strcasestr(level, "bsc"))
+    {
+        level = "bachelor";
+    }
+    else if (strcasestr(level, "master") || strcasestr(level, "msc"))
+    {
+        level = "master";
+    }
+    else if (strcasestr(level, "doct") || strcasestr(level, "phd"))
+    {
+        level = "doctorate";
+    }
+    addFeature(terms, 'l', level, META_WEIGHT);
+}
+
+static int compareDf(const void *a, const void *b)
+{
+    const Term *x = *(Term *const *)a, *y = *(Term *const *)b;
+    if (x->df != y->df)
+    {
+        return x->df > y->df ? -1 : 1;
+    }
+    return strcmp(x->key, y->key);
+}
+
+static void termsFree(Terms *terms)
+{
+    for (uint32_t i = 0; i < terms->size; i++)
+    {
+        free(terms->slots[i].key);
+    }
+    free(terms->slots);
+    free(terms->byDf);
+}
+
+/**
+ * @brief Gives a column to every term shared by two or more courses, the
+ * most common first, up to SIMILAR_MAX_DIMS
+ * @return number of columns
+ */
+static int assignColumns(Terms *terms)
+{
+    uint32_t shared = 0;
+    for (uint32_t i = 0; i < terms->size; i++)
+    {
+        Term *term = &terms->slots[i];
+        term->column = -1;
+        // a term of one course only cannot make two courses similar
+        if (term->key && term->df >= 2)
+        {
+            terms->byDf[shared++] = term;
+        }
+    }
+    qsort(terms->byDf, shared, sizeof(Term *), compareDf);
+    if (shared > SIMILAR_MAX_DIMS)
+    {
+        shared = SIMILAR_MAX_DIMS;
+    }
+    for (uint32_t c = 0; c < shared; c++)
+    {
+        terms->byDf[c]->column = c;
+    }
+    return shared;
+}
+
+int similarBuild(Catalog *cat)
+{
+    Terms terms;
+    memset(&terms, 0, sizeof(terms));
+
+    // first pass: vocabulary and document frequencies
+    if (termsGrow(&terms) < 0)
+    {
+        return -1;
+    }
+    for (terms.course = 0; terms.course < cat->courseCount && !terms.failed; terms.course++)
+    {
+        courseFeatures(cat, terms.course, &terms);
+    }
+    terms.byDf = malloc((terms.count + 1) * sizeof(Term *));
+    if (terms.failed || terms.byDf == NULL)
+    {
+        termsFree(&terms);
+        return -1;
+    }
+    int columns = assignColumns(&terms);
+
+    // rows are padded to whole vectors so the kernel needs no tail loop
+    cat->vectorDims = (columns + 15) / 16 * 16;
+    size_t rowBytes = cat->vectorDims * sizeof(float);
+    cat->vectors = aligned_alloc(sizeof(Vec8), (size_t)cat->courseCount * rowBytes + sizeof(Vec8));
+    if (cat->vectors == NULL)
+    {
+        termsFree(&terms);
+        return -1;
+    }
+    memset(cat->vectors, 0, (size_t)cat->courseCount * rowBytes);
+
+    // second pass: smoothed TF-IDF weights, rare terms weigh most
+    for (uint32_t i = 0; i < cat->courseCount; i++)
+    {
+        float *row = cat->vectors + (size_t)i * cat->vectorDims;
+        terms.row = row;
+        courseFeatures(cat, i, &terms);
+
+        float norm = 0;
+        for (int c = 0; c < columns; c++)
+        {
+            row[c] *= logf((cat->courseCount + 1.0f) / (terms.byDf[c]->df + 1.0f)) + 1.0f;
+            norm += row[c] * row[c];
+        }
+        norm = norm > 0 ? 1.0f / sqrtf(norm) : 0;
+        for (int c = 0; c < columns; c++)
+        {
+            row[c] *= norm;
+        }
+    }
+
+    termsFree(&terms);
+    return 0;
+}
+
+static int better(const SimilarMatch *a, const SimilarMatch *b)
+{
+    return a->score > b->score || (a->score == b->score && a->course < b->course);
+}
+
+/**
+ * @brief Inserts m into the sorted top k list best of count entries
+ */
+static void keepBest(SimilarMatch *best, int *count, int k, SimilarMatch m)
+{
+    if (*count == k && !better(&m, &best[k - 1]))
+    {
+        return;
+    }
+    int i = *count < k ? (*count)++ : k - 1;
+    while (i > 0 && better(&m, &best[i - 1]))
+    {
+        best[i] = best[i - 1];
+        i--;
+    }
+    best[i] = m;
+}
+
+static void *workerRun(void *arg)
+{
+    Worker *w = arg;
+    const Catalog *cat = w->cat;
+
+    for (uint32_t i = w->begin; i < w->end; i++)
+    {
+        if (cat->courses[i].value[DIM_UNI] == w->uni)
+        {
+            continue;
+        }
+        float score = dot(w->query, cat->vectors + (size_t)i * cat->vectorDims, cat->vectorDims);
+        if (score > 0)
+        {
+            keepBest(w->best, &w->count, w->k, (SimilarMatch){i, score});
+        }
+    }
+    return NULL;
+}
+
+int similarFind(const Catalog *cat, uint32_t course, SimilarMatch *out, int k)
+{
+    if (course >= cat->courseCount || k < 1 || k > SIMILAR_MAX_K)
+    {
+        return -1;
+    }
+
+    int threads = 1;
+    if (cat->courseCount >= PARALLEL_MIN)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores < 1 ? 1 : cores > SIMILAR_MAX_THREADS ? SIMILAR_MAX_THREADS : cores;
+    }
+    Worker *workers = calloc(threads, sizeof(Worker));
+    if (workers == NULL)
+    {
+        fprintf(stderr, "Not enough memory!\n");
+        return -1;
+    }
+
+    // each worker scores a contiguous block of rows
+    uint32_t block = (cat->courseCount + threads - 1) / threads;
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].cat = cat;
+        workers[t].query = cat->vectors + (size_t)course * cat->vectorDims;
+        workers[t].uni = cat->courses[course].value[DIM_UNI];
+        workers[t].begin = t * block < cat->courseCount ? t * block : cat->courseCount;
+        workers[t].end = workers[t].begin + block < cat->courseCount ? workers[t].begin + block : cat->courseCount;
+        workers[t].k = k;
+    }
+
+    // worker 0 runs on the calling thread; a block whose thread fails to start runs here too
+    int started[SIMILAR_MAX_THREADS] = {0};
+    for (int t = 1; t < threads; t++)
+    {
+        started[t] = pthread_create(&workers[t].tid, NULL, workerRun, &workers[t]) == 0;
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        if (t == 0 || !started[t])
+        {
+            workerRun(&workers[t]);
+        }
+    }
+
+    int count = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        if (started[t])
+        {
+            pthread_join(workers[t].tid, NULL);
+        }
+        for (int i = 0; i < workers[t].count; i++)
+        {
+            keepBest(out, &count, k, workers[t].best[i]);
+        }
+    }
+    free(workers);
+    return count;
+}
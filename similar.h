@@ -0,0 +1,40 @@
+#ifndef SIMILAR_H
+#define SIMILAR_H
+
+#include <stdint.h>
+
+#include "catalog.h"
+
+#define SIMILAR_MAX_DIMS 4096 // terms kept as vector dimensions
+#define SIMILAR_MAX_K 50       // matches returned by one search
+#define SIMILAR_MAX_THREADS 16
+
+/**
+ * @brief Course of another university and its cosine similarity
+ */
+typedef struct {
+    uint32_t course; // catalog index
+    float score;
+} SimilarMatch;
+
+/**
+ * @brief Builds cat->vectors: one TF-IDF vector per course over the words
+ * of its name, the letter prefix of its code, its faculty and its
+ * normalized study level, scaled to unit length. Terms shared by at least
+ * two courses become dimensions, the most common SIMILAR_MAX_DIMS of them.
+ * @return 0 on success, -1 if out of memory
+ */
+int similarBuild(Catalog *cat);
+
+/**
+ * @brief Finds the courses of other universities most similar to course
+ * by dot products of their vectors, scored on worker threads for large
+ * catalogs
+ * @param course catalog index
+ * @param out best matches first
+ * @param k size of out, at most SIMILAR_MAX_K
+ * @return number of matches written to out, -1 on failure
+ */
+int similarFind(const Catalog *cat, uint32_t course, SimilarMatch *out, int k);
+
+#endif
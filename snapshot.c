@@ -0,0 +1,314 @@
+#include <stddef.h> // offsetof
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+
+#define SNAPSHOT_ALIGN 64 // section alignment, enough for the vector kernel
+#define BYTE_ORDER_MARK 0x01020304u
+
+enum
+{
+    SECTION_COURSES,
+    SECTION_STRINGS,
+    SECTION_VALUES,                            // one per dimension
+    SECTION_BITSETS = SECTION_VALUES + CATALOG_DIMS, // one per dimension
+    SECTION_OPTIONS = SECTION_BITSETS + CATALOG_DIMS, // one per dimension
+    SECTION_OPTION_BITS = SECTION_OPTIONS + CATALOG_DIMS, // one per dimension
+    SECTION_SUGGESTIONS = SECTION_OPTION_BITS + CATALOG_DIMS,
+    SECTION_SUGGEST_KEYS,
+    SECTION_VECTORS,
+    SECTION_COUNT
+};
+
+/**
+ * @brief First bytes of a snapshot; section offsets count from the file start
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;  // BYTE_ORDER_MARK as written
+    uint32_t recordSize; // sizeof(CatalogCourse)
+    uint32_t headerSize;
+    CatalogSource source; // database the snapshot was built from
+    uint64_t size;        // whole file
+    uint64_t checksum;    // of the bytes after the header
+
+    uint32_t courseCount;
+    uint32_t stringsSize;
+    uint32_t bitsetWords;
+    uint32_t valueCount[CATALOG_DIMS];
+    uint32_t optionCount[CATALOG_DIMS];
+    uint32_t suggestionCount;
+    uint32_t suggestKeysSize;
+    uint32_t vectorDims;
+
+    uint64_t offset[SECTION_COUNT];
+    uint64_t length[SECTION_COUNT];
+} SnapshotHeader;
+
+static const char snapshotMagic[8] = "EQCATSNP";
+
+static uint64_t align(uint64_t n)
+{
+    return (n + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+}
+
+/**
+ * @brief 64-bit hash of data, eight bytes per step
+ */
+static uint64_t checksum(const unsigned char *data, size_t len)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = (h ^ word) * 0x100000001B3ull;
+        h ^= h >> 29;
+    }
+    for (; i < len; i++)
+    {
+        h = (h ^ data[i]) * 0x100000001B3ull;
+    }
+    return h;
+}
+
+/**
+ * @brief Lists where each catalog array lives and how many bytes it holds
+ */
+static void catalogSections(const Catalog *cat, void *data[SECTION_COUNT], uint64_t length[SECTION_COUNT])
+{
+    data[SECTION_COURSES] = cat->courses;
+    length[SECTION_COURSES] = (uint64_t)cat->courseCount * sizeof(CatalogCourse);
+    data[SECTION_STRINGS] = cat->strings;
+    length[SECTION_STRINGS] = cat->stringsSize;
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        data[SECTION_VALUES + dim] = cat->values[dim];
+        length[SECTION_VALUES + dim] = (uint64_t)cat->valueCount[dim] * sizeof(uint32_t);
+        data[SECTION_BITSETS + dim] = cat->bitsets[dim];
+        length[SECTION_BITSETS + dim] = (uint64_t)cat->valueCount[dim] * cat->bitsetWords * sizeof(uint64_t);
+        data[SECTION_OPTIONS + dim] = cat->options[dim];
+        length[SECTION_OPTIONS + dim] = (uint64_t)cat->optionCount[dim] * sizeof(uint32_t);
+        data[SECTION_OPTION_BITS + dim] = cat->optionBits[dim];
+        length[SECTION_OPTION_BITS + dim] = (uint64_t)cat->optionCount[dim] * cat->bitsetWords * sizeof(uint64_t);
+    }
+    data[SECTION_SUGGESTIONS] = cat->suggestions;
+    length[SECTION_SUGGESTIONS] = (uint64_t)cat->suggestionCount * sizeof(CatalogSuggestion);
+    data[SECTION_SUGGEST_KEYS] = cat->suggestKeys;
+    length[SECTION_SUGGEST_KEYS] = cat->suggestKeysSize;
+    data[SECTION_VECTORS] = cat->vectors;
+    length[SECTION_VECTORS] = (uint64_t)cat->courseCount * cat->vectorDims * sizeof(float);
+}
+
+int snapshotWrite(const Catalog *cat, const char *path)
+{
+    SnapshotHeader header;
+    void *data[SECTION_COUNT];
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.recordSize = sizeof(CatalogCourse);
+    header.headerSize = sizeof(SnapshotHeader);
+    header.source = cat->source;
+    header.courseCount = cat->courseCount;
+    header.stringsSize = cat->stringsSize;
+    header.bitsetWords = cat->bitsetWords;
+    memcpy(header.valueCount, cat->valueCount, sizeof(header.valueCount));
+    memcpy(header.optionCount, cat->optionCount, sizeof(header.optionCount));
+    header.suggestionCount = cat->suggestionCount;
+    header.suggestKeysSize = cat->suggestKeysSize;
+    header.vectorDims = cat->vectorDims;
+
+    catalogSections(cat, data, header.length);
+    uint64_t size = align(sizeof(SnapshotHeader));
+    for (int s = 0; s < SECTION_COUNT; s++)
+    {
+        header.offset[s] = size;
+        size = align(size + header.length[s]);
+    }
+    header.size = size;
+
+    unsigned char *image = calloc(1, size);
+    if (image == NULL)
+    {
+        fprintf(stderr, "Not enough memory!\n");
+        return -1;
+    }
+    for (int s = 0; s < SECTION_COUNT; s++)
+    {
+        if (header.length[s])
+        {
+            memcpy(image + header.offset[s], data[s], header.length[s]);
+        }
+    }
+    header.checksum = checksum(image + sizeof(SnapshotHeader), size - sizeof(SnapshotHeader));
+    memcpy(image, &header, sizeof(header));
+
+    // readers see the old snapshot or the new one, never half of it
+    char tmpPath[4096];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+    FILE *file = fopen(tmpPath, "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error: cannot create %s\n", tmpPath);
+        free(image);
+        return -1;
+    }
+    int ok = fwrite(image, 1, size, file) == size && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+    free(image);
+    if (!ok || rename(tmpPath, path) < 0)
+    {
+        fprintf(stderr, "Error: cannot write %s\n", path);
+        unlink(tmpPath);
+        return -1;
+    }
+    fprintf(stderr, "Wrote catalog snapshot %s (%llu bytes)\n", path, (unsigned long long)size);
+    return 0;
+}
+
+/**
+ * @brief Checks that the header describes a complete snapshot of this
+ * build's layout whose sections fit the file
+ */
+static int headerValid(const SnapshotHeader *h, uint64_t fileSize)
+{
+    if (memcmp(h->magic, snapshotMagic, sizeof(h->magic)) != 0 || h->version != SNAPSHOT_VERSION ||
+        h->byteOrder != BYTE_ORDER_MARK || h->recordSize != sizeof(CatalogCourse) ||
+        h->headerSize != sizeof(SnapshotHeader) || h->size != fileSize)
+    {
+        return 0;
+    }
+
+    // the counts must produce exactly the stored section lengths
+    Catalog counts;
+    void *data[SECTION_COUNT];
+    uint64_t length[SECTION_COUNT];
+    memset(&counts, 0, sizeof(counts));
+    counts.courseCount = h->courseCount;
+    counts.stringsSize = h->stringsSize;
+    counts.bitsetWords = h->bitsetWords;
+    memcpy(counts.valueCount, h->valueCount, sizeof(counts.valueCount));
+    memcpy(counts.optionCount, h->optionCount, sizeof(counts.optionCount));
+    counts.suggestionCount = h->suggestionCount;
+    counts.suggestKeysSize = h->suggestKeysSize;
+    counts.vectorDims = h->vectorDims;
+    catalogSections(&counts, data, length);
+
+    for (int s = 0; s < SECTION_COUNT; s++)
+    {
+        if (length[s] != h->length[s] || h->offset[s] % SNAPSHOT_ALIGN != 0 ||
+            h->offset[s] < sizeof(SnapshotHeader) || h->offset[s] > fileSize ||
+            h->length[s] > fileSize - h->offset[s])
+        {
+            return 0;
+        }
+    }
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        if (h->valueCount[dim] > CATALOG_MAX_VALUES || h->optionCount[dim] > CATALOG_MAX_VALUES)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int snapshotLoad(Catalog *cat, const char *path, const char *dbPath)
+{
+    struct stat st;
+    CatalogSource current;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(SnapshotHeader))
+    {
+        fprintf(stderr, "Catalog snapshot %s is truncated\n", path);
+        close(fd);
+        return -1;
+    }
+    unsigned char *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        perror("mmap");
+        return -1;
+    }
+
+    const SnapshotHeader *h = (const SnapshotHeader *)base;
+    const char *problem = NULL;
+    if (memcmp(h->magic, snapshotMagic, sizeof(h->magic)) == 0 && h->size > (uint64_t)st.st_size)
+    {
+        problem = "is truncated";
+    }
+    else if (!headerValid(h, st.st_size))
+    {
+        problem = "was written by another version";
+    }
+    else if (catalogSourceStat(dbPath, &current) < 0)
+    {
+        problem = "is stale";
+    }
+    // an untouched database file needs no fingerprint; saving a selection
+    // rewrites the file but leaves the catalog tables alone
+    else if (memcmp(&current, &h->source, offsetof(CatalogSource, fingerprint)) != 0 &&
+             (catalogFingerprint(dbPath, &current.fingerprint) < 0 || current.fingerprint != h->source.fingerprint))
+    {
+        problem = "is stale";
+    }
+    else if (checksum(base + sizeof(SnapshotHeader), h->size - sizeof(SnapshotHeader)) != h->checksum)
+    {
+        problem = "is corrupt";
+    }
+    if (problem)
+    {
+        fprintf(stderr, "Catalog snapshot %s %s\n", path, problem);
+        munmap(base, st.st_size);
+        return -1;
+    }
+
+    memset(cat, 0, sizeof(Catalog));
+    current.fingerprint = h->source.fingerprint;
+    cat->source = current;
+    cat->courseCount = h->courseCount;
+    cat->stringsSize = h->stringsSize;
+    cat->bitsetWords = h->bitsetWords;
+    memcpy(cat->valueCount, h->valueCount, sizeof(cat->valueCount));
+    memcpy(cat->optionCount, h->optionCount, sizeof(cat->optionCount));
+    cat->suggestionCount = h->suggestionCount;
+    cat->suggestKeysSize = h->suggestKeysSize;
+    cat->vectorDims = h->vectorDims;
+
+    // the arrays are used in place; the mapping is read-only
+    cat->courses = (CatalogCourse *)(base + h->offset[SECTION_COURSES]);
+    cat->strings = (char *)(base + h->offset[SECTION_STRINGS]);
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        cat->values[dim] = (uint32_t *)(base + h->offset[SECTION_VALUES + dim]);
+        cat->bitsets[dim] = (uint64_t *)(base + h->offset[SECTION_BITSETS + dim]);
+        cat->options[dim] = (uint32_t *)(base + h->offset[SECTION_OPTIONS + dim]);
+        cat->optionBits[dim] = (uint64_t *)(base + h->offset[SECTION_OPTION_BITS + dim]);
+    }
+    cat->suggestions = (CatalogSuggestion *)(base + h->offset[SECTION_SUGGESTIONS]);
+    cat->suggestKeys = (char *)(base + h->offset[SECTION_SUGGEST_KEYS]);
+    cat->vectors = (float *)(base + h->offset[SECTION_VECTORS]);
+    cat->mapping = base;
+    cat->mappingSize = st.st_size;
+
+    fprintf(stderr, "Mapped %u courses from catalog snapshot %s\n", cat->courseCount, path);
+    return 0;
+}
@@ -0,0 +1,28 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "catalog.h"
+
+#define SNAPSHOT_VERSION 3
+
+/**
+ * @brief Writes the catalog and its indexes to path as one binary file:
+ * a header followed by the catalog arrays at fixed, aligned offsets. The
+ * file is written next to path and renamed over it.
+ * @return 0 on success, -1 on failure
+ */
+int snapshotWrite(const Catalog *cat, const char *path);
+
+/**
+ * @brief Maps the snapshot at path read-only and points the catalog
+ * arrays into it, so processes serving the same snapshot share its pages
+ * @param dbPath database the snapshot must have been built from. While
+ * its inode, size and mtime are those in the header it is not read; once
+ * they differ, a snapshot whose catalog fingerprint differs from the
+ * database's counts as stale
+ * @return 0 on success, -1 if the snapshot is missing, stale, truncated
+ * or corrupt
+ */
+int snapshotLoad(Catalog *cat, const char *path, const char *dbPath);
+
+#endif
@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "template.h"
+
+static int findSlot(const char *name, size_t len, const char *const *slots, int slotCount)
+{
+    for (int i = 0; i < slotCount; i++)
+    {
+        if (strlen(slots[i]) == len && strncmp(name, slots[i], len) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int lineOf(const char *text, const char *at)
+{
+    int line = 1;
+    for (const char *p = text; p < at; p++)
+    {
+        line += *p == '\n';
+    }
+    return line;
+}
+
+int templateCompile(Template *tpl, const char *text, const char *const *slots, int slotCount)
+{
+    memset(tpl, 0, sizeof(Template));
+    tpl->text = strdup(text);
+
+    // every tag adds at most a literal and its own op
+    int maxOps = 1;
+    for (const char *p = strstr(text, "{{"); p; p = strstr(p + 2, "{{"))
+    {
+        maxOps += 2;
+    }
+    tpl->ops = (TemplateOp *)malloc(maxOps * sizeof(TemplateOp));
+    if (tpl->text == NULL || tpl->ops == NULL)
+    {
+        fprintf(stderr, "Not enough memory!\n");
+        templateFree(tpl);
+        return -1;
+    }
+
+    int section = -1; // op index of the open section
+    const char *p = tpl->text;
+    while (*p)
+    {
+        const char *open = strstr(p, "{{");
+        const char *literalEnd = open ? open : p + strlen(p);
+        if (literalEnd > p)
+        {
+            TemplateOp *op = &tpl->ops[tpl->opCount++];
+            op->kind = TEMPLATE_TEXT;
+            op->start = p - tpl->text;
+            op->len = literalEnd - p;
+        }
+        if (open == NULL)
+        {
+            break;
+        }
+
+        const char *close = strstr(open + 2, "}}");
+        const char *name = open + 2;
+        int kind = TEMPLATE_SLOT;
+        if (close && (*name == '#' || *name == '/'))
+        {
+            kind = *name == '#' ? TEMPLATE_SECTION : TEMPLATE_END;
+            name++;
+        }
+        int slot = close ? findSlot(name, close - name, slots, slotCount) : -1;
+        if (slot < 0 || (kind == TEMPLATE_SECTION && section >= 0) ||
+            (kind == TEMPLATE_END && (section < 0 || tpl->ops[section].slot != slot)))
+        {
+            fprintf(stderr, "Template error: bad tag at line %d\n", lineOf(tpl->text, open));
+            templateFree(tpl);
+            return -1;
+        }
+
+        TemplateOp *op = &tpl->ops[tpl->opCount];
+        op->kind = kind;
+        op->slot = slot;
+        if (kind == TEMPLATE_SECTION)
+        {
+            section = tpl->opCount;
+        }
+        else if (kind == TEMPLATE_END)
+        {
+            tpl->ops[section].end = tpl->opCount;
+            section = -1;
+        }
+        tpl->opCount++;
+        p = close + 2;
+    }
+
+    if (section >= 0)
+    {
+        fprintf(stderr, "Template error: unclosed section\n");
+        templateFree(tpl);
+        return -1;
+    }
+    return 0;
+}
+
+int templateLoad(Template *tpl, const char *path, const char *const *slots, int slotCount)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error: cannot open template %s\n", path);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *text = (char *)malloc(size + 1);
+    if (text == NULL || fread(text, 1, size, file) != (size_t)size)
+    {
+        fprintf(stderr, "Error: cannot read template %s\n", path);
+        free(text);
+        fclose(file);
+        return -1;
+    }
+    text[size] = '\0';
+    fclose(file);
+
+    int result = templateCompile(tpl, text, slots, slotCount);
+    free(text);
+    if (result < 0)
+    {
+        fprintf(stderr, "in %s\n", path);
+    }
+    return result;
+}
+
+void templateFree(Template *tpl)
+{
+    free(tpl->text);
+    free(tpl->ops);
+    memset(tpl, 0, sizeof(Template));
+}
+
+static void writeEscaped(FILE *out, const char *s)
+{
+    for (; *s; s++)
+    {
+        switch (*s)
+        {
+        case '&':
+            fputs("&amp;", out);
+            break;
+        case '<':
+            fputs("&lt;", out);
+            break;
+        case '>':
+            fputs("&gt;", out);
+            break;
+        case '"':
+            fputs("&quot;", out);
+            break;
+        case '\'':
+            fputs("&#39;", out);
+            break;
+        default:
+            fputc(*s, out);
+        }
+    }
+}
+
+void templateRender(const Template *tpl, const TemplateData *data, FILE *out)
+{
+    int row = -1;
+    int rows = 0;
+    int section = -1;
+
+    for (int i = 0; i < tpl->opCount; i++)
+    {
+        const TemplateOp *op = &tpl->ops[i];
+        switch (op->kind)
+        {
+        case TEMPLATE_TEXT:
+            fwrite(tpl->text + op->start, 1, op->len, out);
+            break;
+        case TEMPLATE_SLOT:
+        {
+            const char *value = data->value(data->context, op->slot, row);
+            if (value)
+            {
+                writeEscaped(out, value);
+            }
+            break;
+        }
+        case TEMPLATE_SECTION:
+            rows = data->rows(data->context, op->slot);
+            if (rows <= 0)
+            {
+                i = op->end; // skip the section
+                break;
+            }
+            section = i;
+            row = 0;
+            break;
+        case TEMPLATE_END:
+            if (++row < rows)
+            {
+                i = section; // next row
+            }
+            else
+            {
+                row = -1;
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef TEMPLATE_H
+#define TEMPLATE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * @brief Kinds of compiled template operations
+ */
+enum
+{
+    TEMPLATE_TEXT,    // literal slice of the template text
+    TEMPLATE_SLOT,    // value of a slot, HTML-escaped
+    TEMPLATE_SECTION, // start of a section repeated once per row
+    TEMPLATE_END      // end of the section
+};
+
+typedef struct {
+    int kind;
+    int slot;       // SLOT, SECTION: slot id
+    int end;        // SECTION: index of the matching END
+    uint32_t start; // TEXT: offset into the template text
+    uint32_t len;   // TEXT: length of the slice
+} TemplateOp;
+
+/**
+ * @brief Template compiled to a flat list of literal slices and slot
+ * references. {{name}} inserts a value, {{#name}}...{{/name}} repeats the
+ * enclosed part once per row of section name; sections do not nest.
+ */
+typedef struct {
+    char *text;
+    int opCount;
+    TemplateOp *ops;
+} Template;
+
+/**
+ * @brief Values a template is rendered with
+ */
+typedef struct {
+    void *context;
+    // text of slot in row of the enclosing section, row is -1 outside sections
+    const char *(*value)(void *context, int slot, int row);
+    // rows of section slot
+    int (*rows)(void *context, int slot);
+} TemplateData;
+
+/**
+ * @brief Compiles text into tpl
+ * @param slots slot names, indexed by slot id
+ * @return 0 on success, -1 on a syntax error or unknown slot
+ */
+int templateCompile(Template *tpl, const char *text, const char *const *slots, int slotCount);
+
+/**
+ * @brief Reads the file at path and compiles it into tpl
+ * @return 0 on success, -1 on failure
+ */
+int templateLoad(Template *tpl, const char *path, const char *const *slots, int slotCount);
+
+void templateFree(Template *tpl);
+
+/**
+ * @brief Writes the template filled with data to out
+ */
+void templateRender(const Template *tpl, const TemplateData *data, FILE *out);
+
+#endif
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h> // strncasecmp
+
+#include <sqlite3.h>
+
+#include "catalog.h"
+
+#define DATABASE "euroteq.db"
+
+static Catalog cat;
+static sqlite3 *db;
+static int failures;
+
+// conditions of the SQL search, in catalog dimension order
+static const char *conditions[CATALOG_DIMS] = {
+    "University = ?",
+    "Faculty = ?",
+    "Studylevel like '%' || ? || '%'",
+    "Semester like '%' || ? || '%'",
+};
+
+static void check(int ok, const char *test, const char *what, long a, long b)
+{
+    if (!ok)
+    {
+        printf("FAIL %s: %s (%ld, %ld)\n", test, what, a, b);
+        failures++;
+    }
+}
+
+/**
+ * @brief Counts the rows of courses the SQL search returns for the filter:
+ * terms of one dimension OR-ed, dimensions AND-ed
+ */
+static long searchCount(const CatalogFilter *filter, const char *nameTerm)
+{
+    char sql[4096] = "SELECT COUNT(*) FROM courses WHERE 1";
+    const char *params[CATALOG_DIMS * CATALOG_MAX_TERMS + 1];
+    int paramCount = 0;
+
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        for (int t = 0; t < filter->termCount[dim]; t++)
+        {
+            strcat(sql, t ? " or " : " and (");
+            strcat(sql, conditions[dim]);
+            params[paramCount++] = filter->terms[dim][t];
+        }
+        if (filter->termCount[dim])
+        {
+            strcat(sql, ")");
+        }
+    }
+    if (nameTerm)
+    {
+        strcat(sql, " and Course like '%' || ? || '%'");
+        params[paramCount++] = nameTerm;
+    }
+
+    sqlite3_stmt *stmt;
+    long count = -1;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK)
+    {
+        for (int i = 0; i < paramCount; i++)
+        {
+            sqlite3_bind_text(stmt, i + 1, params[i], -1, SQLITE_STATIC);
+        }
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            count = sqlite3_column_int64(stmt, 0);
+        }
+    }
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+/**
+ * @brief Checks every facet count of one search against the result count
+ * of the search with that option as its only term in the dimension
+ */
+static void testFacets(const CatalogFilter *filter, const char *nameTerm)
+{
+    uint32_t counts[CATALOG_DIMS][CATALOG_MAX_VALUES];
+    char test[256];
+    int n = snprintf(test, sizeof(test), "facets");
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        for (int t = 0; t < filter->termCount[dim] && n < (int)sizeof(test) - 64; t++)
+        {
+            n += snprintf(test + n, sizeof(test) - n, " %d=%s", dim, filter->terms[dim][t]);
+        }
+    }
+    if (nameTerm)
+    {
+        snprintf(test + n, sizeof(test) - n, " name=%s", nameTerm);
+    }
+
+    uint32_t total = catalogFacetCounts(&cat, filter, nameTerm, counts);
+    check(total == searchCount(filter, nameTerm), test, "total is the result count", total,
+          searchCount(filter, nameTerm));
+
+    for (int dim = 0; dim < CATALOG_DIMS; dim++)
+    {
+        CatalogFilter facet = *filter;
+        facet.termCount[dim] = 1;
+        for (uint32_t o = 0; o < cat.optionCount[dim]; o++)
+        {
+            const char *option = catalogString(&cat, cat.options[dim][o]);
+            facet.terms[dim][0] = option;
+            long expected = searchCount(&facet, nameTerm);
+            // options no result lists are hidden, the others count all their results
+            check(counts[dim][o] == 0 || counts[dim][o] == expected, option, test, counts[dim][o], expected);
+            check(strchr(option, ',') == NULL, option, "an option is a single value", dim, o);
+        }
+    }
+}
+
+/**
+ * @brief Options shown for the results of a university are the parts of
+ * the values its courses store, as on its page
+ */
+static void testListedOptions(const char *uni)
+{
+    CatalogFilter filter;
+    uint32_t counts[CATALOG_DIMS][CATALOG_MAX_VALUES];
+    memset(&filter, 0, sizeof(filter));
+    catalogFilterAdd(&filter, DIM_UNI, uni);
+    catalogFacetCounts(&cat, &filter, NULL, counts);
+
+    for (int dim = DIM_DEGREE; dim <= DIM_SEMESTER; dim++)
+    {
+        char sql[256];
+        sqlite3_stmt *stmt;
+        snprintf(sql, sizeof(sql), "SELECT DISTINCT %s FROM courses WHERE University = ?",
+                 dim == DIM_DEGREE ? "Studylevel" : "Semester");
+        sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+        sqlite3_bind_text(stmt, 1, uni, -1, SQLITE_STATIC);
+        int listed[CATALOG_MAX_VALUES] = {0};
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const char *text = (const char *)sqlite3_column_text(stmt, 0);
+            const char *part;
+            size_t len;
+            while (text && (part = catalogNextOption(&text, &len)) != NULL)
+            {
+                for (uint32_t o = 0; o < cat.optionCount[dim] && len; o++)
+                {
+                    const char *option = catalogString(&cat, cat.options[dim][o]);
+                    listed[o] |= strlen(option) == len && strncasecmp(option, part, len) == 0;
+                }
+            }
+        }
+        sqlite3_finalize(stmt);
+        for (uint32_t o = 0; o < cat.optionCount[dim]; o++)
+        {
+            check((counts[dim][o] > 0) == listed[o], uni, catalogString(&cat, cat.options[dim][o]), counts[dim][o],
+                  listed[o]);
+        }
+    }
+}
+
+int main(void)
+{
+    if (catalogLoad(&cat, DATABASE) < 0 || sqlite3_open_v2(DATABASE, &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+    {
+        printf("catalog: cannot load %s\n", DATABASE);
+        return 1;
+    }
+
+    CatalogFilter filter;
+    memset(&filter, 0, sizeof(filter));
+    testFacets(&filter, NULL);
+    for (uint32_t u = 0; u < cat.optionCount[DIM_UNI]; u++)
+    {
+        const char *uni = catalogString(&cat, cat.options[DIM_UNI][u]);
+        testListedOptions(uni);
+
+        memset(&filter, 0, sizeof(filter));
+        catalogFilterAdd(&filter, DIM_UNI, uni);
+        testFacets(&filter, NULL);
+        testFacets(&filter, "data");
+        // one more term in each substring dimension
+        for (int dim = DIM_DEGREE; dim <= DIM_SEMESTER; dim++)
+        {
+            for (uint32_t o = 0; o < cat.optionCount[dim]; o++)
+            {
+                CatalogFilter narrowed = filter;
+                catalogFilterAdd(&narrowed, dim, catalogString(&cat, cat.options[dim][o]));
+                testFacets(&narrowed, NULL);
+            }
+        }
+    }
+    // several terms in one dimension are OR-ed
+    memset(&filter, 0, sizeof(filter));
+    catalogFilterAdd(&filter, DIM_UNI, "DTU");
+    catalogFilterAdd(&filter, DIM_UNI, "TalTech");
+    catalogFilterAdd(&filter, DIM_SEMESTER, "Spring");
+    catalogFilterAdd(&filter, DIM_DEGREE, "Master");
+    catalogFilterAdd(&filter, DIM_DEGREE, "Bachelor");
+    testFacets(&filter, NULL);
+
+    sqlite3_close(db);
+    catalogFree(&cat);
+    if (failures)
+    {
+        printf("catalog: %d failures\n", failures);
+        return 1;
+    }
+    printf("catalog: ok\n");
+    return 0;
+}
@@ -0,0 +1,276 @@
+#!/usr/bin/env python3
+"""Request-level tests of the server, run against one I/O backend.
+
+Usage: tests/http_test.py epoll|io_uring
+
+Starts ./server on its fixed port with short timeouts and small limits,
+talks raw HTTP to it and stops it again.
+"""
+
+import json
+import socket
+import sqlite3
+import subprocess
+import sys
+import time
+
+HOST, PORT = "127.0.0.1", 2728
+DATABASE = "euroteq.db"
+MAX_CONNECTIONS = 4
+FLAGS = ["--header-timeout", "1", "--idle-timeout", "1", "--max-connections", str(MAX_CONNECTIONS),
+         "--rate", "0.1", "--burst", "2"]
+
+failures = 0
+
+
+def check(ok, what):
+    global failures
+    if not ok:
+        print("FAIL", what)
+        failures += 1
+
+
+def connect(source=""):
+    s = socket.create_connection((HOST, PORT), timeout=5, source_address=(source, 0))
+    s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    return s
+
+
+def read_response(s, buf=b""):
+    """Reads one response; returns (status, headers, body, rest of buf), or
+    None if the server closed first"""
+    while b"\r\n\r\n" not in buf:
+        data = s.recv(65536)
+        if not data:
+            return None
+        buf += data
+    head, buf = buf.split(b"\r\n\r\n", 1)
+    lines = head.decode().split("\r\n")
+    headers = {}
+    for line in lines[1:]:
+        name, _, value = line.partition(":")
+        headers[name.strip().lower()] = value.strip()
+    length = int(headers.get("content-length", "0"))
+    while len(buf) < length:
+        data = s.recv(65536)
+        if not data:
+            break
+        buf += data
+    return int(lines[0].split()[1]), headers, buf[:length], buf[length:]
+
+
+def closed_by_server(s, within):
+    """Tells whether the server ends the connection within the given seconds"""
+    s.settimeout(within)
+    try:
+        while s.recv(65536):
+            pass
+        return True
+    except ConnectionResetError:
+        return True
+    except socket.timeout:
+        return False
+
+
+def test_get():
+    s = connect()
+    s.sendall(b"GET / HTTP/1.1\r\nHost: x\r\n\r\n")
+    r = read_response(s)
+    check(r is not None and r[0] == 200 and b"<html" in r[2].lower(), "GET / answers 200 with the index page")
+    s.close()
+
+
+def test_slow_header():
+    s = connect()
+    s.sendall(b"GET / HTTP/1.1\r\n")
+    start = time.monotonic()
+    closed = closed_by_server(s, 3)
+    check(closed and time.monotonic() - start >= 0.8, "an unfinished request head is closed after the header timeout")
+    s.close()
+
+
+def test_pipelined():
+    s = connect()
+    s.sendall(b"GET /index/style.css HTTP/1.1\r\nHost: x\r\n\r\n"
+              b"GET /missing.css HTTP/1.1\r\nHost: x\r\n\r\n"
+              b"GET /ctu/style.css HTTP/1.1\r\nHost: x\r\n\r\n")
+    statuses = []
+    buf = b""
+    for _ in range(3):
+        r = read_response(s, buf)
+        if r is None:
+            break
+        statuses.append(r[0])
+        buf = r[3]
+    check(statuses == [200, 404, 200], "pipelined requests are answered in order, got %s" % statuses)
+    s.close()
+
+
+def test_post_then_get():
+    s = connect()
+    body = b"x" * 5000
+    s.sendall(b"POST /search HTTP/1.1\r\nHost: x\r\nContent-Length: %d\r\n\r\n" % len(body))
+    time.sleep(0.1)
+    s.sendall(body + b"GET /index/style.css HTTP/1.1\r\nHost: x\r\n\r\n")
+    first = read_response(s)
+    second = first and read_response(s, first[3])
+    check(first is not None and first[0] == 400, "POST is refused with 400")
+    check(second is not None and second[0] == 200 and b"{" in second[2],
+          "the GET after a POST body is answered")
+    s.close()
+
+
+def test_http10_close():
+    s = connect()
+    s.sendall(b"GET /index/style.css HTTP/1.0\r\n\r\n")
+    r = read_response(s)
+    check(r is not None and r[0] == 200, "HTTP/1.0 request is answered")
+    check(closed_by_server(s, 1), "HTTP/1.0 connection is closed after the response")
+    s.close()
+
+
+def test_keep_alive():
+    s = connect()
+    ok = True
+    for _ in range(3):
+        s.sendall(b"GET /index/style.css HTTP/1.1\r\nHost: x\r\n\r\n")
+        r = read_response(s)
+        ok = ok and r is not None and r[0] == 200
+    check(ok, "HTTP/1.1 connection serves several requests")
+    check(closed_by_server(s, 3), "idle kept-alive connection is closed after the idle timeout")
+    s.close()
+
+
+def test_connection_overload():
+    held = [connect() for _ in range(MAX_CONNECTIONS)]
+    time.sleep(0.2)
+    refused = 0
+    for _ in range(5):
+        s = connect()
+        # request bytes the server never reads must not reset the 503
+        s.sendall(b"GET / HTTP/1.1\r\nHost: x\r\n\r\n" + b"x" * 4000)
+        time.sleep(0.05)
+        try:
+            r = read_response(s)
+            refused += r is not None and r[0] == 503 and "retry-after" in r[1]
+        except ConnectionResetError:
+            pass
+        s.close()
+    for s in held:
+        s.close()
+    check(refused == 5, "connections above max-connections get 503 with Retry-After, %d of 5" % refused)
+
+
+def test_rate_limit():
+    s = connect()
+    statuses = []
+    for _ in range(3):
+        s.sendall(b"GET /similar?id=5 HTTP/1.1\r\nHost: x\r\n\r\n")
+        r = read_response(s)
+        statuses.append(r and r[0])
+        if r is None:
+            break
+        if r[0] != 200:
+            s.close()
+            s = connect()
+    for _ in range(5):
+        s.sendall(b"GET /suggest?q=ma HTTP/1.1\r\nHost: x\r\n\r\n")
+        r = read_response(s)
+        statuses.append(r and r[0])
+    s.close()
+    check(statuses == [200, 200, 503] + [200] * 5,
+          "searches above the burst get 503, typeahead is not charged, got %s" % statuses)
+
+
+def test_long_query():
+    # from a client address of its own, not to spend the tokens of test_rate_limit
+    s = connect("127.0.0.2")
+    rows = []
+    for repeats in (2, 90):
+        query = "uni=DTU&degree=Master" + "&semester=Autumn" * repeats
+        s.sendall(b"GET /output?%s HTTP/1.1\r\nHost: x\r\n\r\n" % query.encode())
+        r = read_response(s)
+        rows.append(r[2].count(b"<tr") if r and r[0] == 200 else None)
+    s.close()
+    check(rows[0] and rows[1] == rows[0],
+          "a search of %d bytes of filters answers like a short one, got %s" % (len(query), rows))
+
+
+def test_similar_k():
+    # k below 1 asks for one match, not for the most
+    s = connect("127.0.0.3")
+    counts = []
+    for k in (0, -5):
+        s.sendall(b"GET /similar?id=5&k=%d HTTP/1.1\r\nHost: x\r\n\r\n" % k)
+        r = read_response(s)
+        counts.append(len(json.loads(r[2])["similar"]) if r and r[0] == 200 else None)
+    s.close()
+    check(counts == [1, 1], "/similar with k of 0 or less answers one match, got %s" % counts)
+
+
+def suggestions(prefix, k, uni=None):
+    """Courses whose code or name starts with prefix, ignoring ASCII case,
+    in the order of their lowercased code or name, then of their id"""
+    con = sqlite3.connect(DATABASE)
+    courses = con.execute("SELECT id, Code, Course, University FROM courses").fetchall()
+    con.close()
+    lower = lambda text: text.encode().lower()
+    key = lower(prefix.lstrip(" "))
+    entries = sorted((lower(text), c[0]) for c in courses for text in c[1:3] if uni in (None, c[3]))
+    found = []
+    for text, course in entries:
+        if text.startswith(key) and course not in found and len(found) < k:
+            found.append(course)
+    return found
+
+
+def test_suggest():
+    s = connect()
+    cases = [("ma", 8, ""), ("Data", 5, "&k=5"), ("%20intro", 8, ""), ("m", 20, "&k=100"), ("a", 3, "&k=3"),
+             ("Ma", 8, "&uni=DTU"), ("zzzz", 8, ""), ("ma", 1, "&k=0"), ("ma", 1, "&k=-3")]
+    for prefix, k, extra in cases:
+        s.sendall(b"GET /suggest?q=%s%s HTTP/1.1\r\nHost: x\r\n\r\n" % (prefix.encode(), extra.encode()))
+        r = read_response(s)
+        got = [c["id"] for c in json.loads(r[2])] if r and r[0] == 200 else None
+        expected = suggestions(prefix.replace("%20", " "), k, "DTU" if "uni" in extra else None)
+        check(got == expected, "/suggest?q=%s%s answers %s, got %s" % (prefix, extra, expected, got))
+    s.close()
+
+
+def main():
+    if len(sys.argv) != 2 or sys.argv[1] not in ("epoll", "io_uring"):
+        print(__doc__.strip().split("\n\n")[1])
+        return 2
+    backend = sys.argv[1]
+
+    server = subprocess.Popen(["./server", "--backend", backend] + FLAGS,
+                              stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    try:
+        for _ in range(100):
+            try:
+                connect().close()
+                break
+            except OSError:
+                time.sleep(0.05)
+        else:
+            print("FAIL server did not start")
+            return 1
+
+        # a server started without io_uring says so and runs epoll
+        for test in (test_get, test_slow_header, test_pipelined, test_post_then_get, test_http10_close,
+                     test_keep_alive, test_connection_overload, test_suggest, test_long_query,
+                     test_similar_k, test_rate_limit):
+            test()
+            time.sleep(0.1)
+    finally:
+        server.terminate()
+        _, log = server.communicate()
+        if backend == "io_uring" and "using epoll" in log:
+            print("note: io_uring unavailable, the epoll backend was tested")
+
+    print("%s: %s" % (backend, "%d failures" % failures if failures else "ok"))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
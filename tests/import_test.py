@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+"""Tests of server --import, run on a copy of euroteq.db in a temporary
+directory.
+
+Usage: tests/import_test.py
+
+Exports the catalog tables as CSV and JSON, imports them back and checks
+that every row comes back unchanged; then checks that malformed files
+fail and leave the database as it was.
+"""
+
+import hashlib
+import json
+import os
+import shutil
+import sqlite3
+import subprocess
+import sys
+import tempfile
+
+SERVER = os.path.abspath("server")
+DATABASE = "euroteq.db"
+TABLES = ["courses", "subjectmap", "faculties", "universities"]
+
+failures = 0
+
+
+def check(ok, what):
+    global failures
+    if not ok:
+        print("FAIL", what)
+        failures += 1
+
+
+def rows(db, table):
+    con = sqlite3.connect(db)
+    result = con.execute('SELECT * FROM "%s" ORDER BY rowid' % table).fetchall()
+    con.close()
+    return result
+
+
+def columns(db, table):
+    con = sqlite3.connect(db)
+    names = [c[1] for c in con.execute('PRAGMA table_info("%s")' % table)]
+    con.close()
+    return names
+
+
+def digest(path):
+    with open(path, "rb") as f:
+        return hashlib.sha256(f.read()).hexdigest()
+
+
+def csv_field(value):
+    # an empty unquoted field is NULL, strings are always quoted
+    if value is None:
+        return ""
+    if isinstance(value, (int, float)):
+        return str(value)
+    return '"%s"' % value.replace('"', '""')
+
+
+def write_csv(path, names, records):
+    with open(path, "w") as f:
+        f.write(",".join(names) + "\n")
+        for record in records:
+            f.write(",".join(csv_field(v) for v in record) + "\r\n")
+
+
+def write_json(path, names, records, lines=False):
+    objects = [dict(zip(names, record)) for record in records]
+    with open(path, "w") as f:
+        if lines:
+            f.write("".join(json.dumps(o) + "\n" for o in objects))
+        else:
+            json.dump(objects, f, indent=1)
+
+
+def run_import(*args):
+    result = subprocess.run([SERVER, "--import"] + list(args), capture_output=True, text=True)
+    return result.returncode, result.stderr
+
+
+def test_round_trip(original):
+    """courses as CSV, subjectmap as a JSON array, faculties and
+    universities as JSON lines"""
+    write_csv("courses.csv", columns(original, "courses"), rows(original, "courses"))
+    write_json("subjectmap.json", columns(original, "subjectmap"), rows(original, "subjectmap"))
+    write_json("faculties.jsonl", columns(original, "faculties"), rows(original, "faculties"), lines=True)
+    write_json("universities.jsonl", columns(original, "universities"), rows(original, "universities"),
+               lines=True)
+
+    con = sqlite3.connect(DATABASE)
+    con.execute('INSERT INTO selected SELECT * FROM courses LIMIT 3')
+    con.commit()
+    con.close()
+    selected = rows(DATABASE, "selected")
+
+    rc, log = run_import("courses=courses.csv", "subjectmap=subjectmap.json", "faculties=faculties.jsonl",
+                         "universities=universities.jsonl")
+    check(rc == 0, "round-trip import succeeds: %s" % log.strip().split("\n")[-1])
+    for table in TABLES:
+        check(rows(DATABASE, table) == rows(original, table), "%s comes back unchanged" % table)
+    check(rows(DATABASE, "selected") == selected and len(selected) == 3, "saved selections are kept")
+    check(not os.path.exists(DATABASE + ".import"), "no temporary database is left behind")
+
+
+def test_derived_subjectmap(original):
+    # courses with a SubjectMap column rebuild subjectmap from it
+    names = columns(original, "courses") + ["SubjectMap"]
+    records = [r + ("https://example.org/%d" % r[0],) for r in rows(original, "courses")[:10]]
+    write_csv("derive.csv", names, records)
+    rc, log = run_import("courses=derive.csv")
+    check(rc == 0, "courses with a SubjectMap column import: %s" % log.strip().split("\n")[-1])
+    check([(r[0], r[3]) for r in rows(DATABASE, "subjectmap")] == [(r[0], r[-1]) for r in records],
+          "subjectmap is derived from the SubjectMap column")
+
+
+def test_kept_subjectmap(original):
+    # courses without a SubjectMap column keep the links of the courses left
+    records = rows(original, "courses")[:10]
+    write_csv("subset.csv", columns(original, "courses"), records)
+    rc, log = run_import("courses=subset.csv")
+    check(rc == 0, "a subset of the courses imports: %s" % log.strip().split("\n")[-1])
+    ids = set(r[0] for r in records)
+    check(rows(DATABASE, "subjectmap") == [r for r in rows(original, "subjectmap") if r[0] in ids],
+          "subjectmap keeps the links of the imported courses only")
+
+
+def test_malformed(original):
+    names = columns(original, "courses")
+    good = rows(original, "courses")
+    first = good[0]
+
+    def with_row(row, at=7):
+        return good[:at] + [row] + good[at:]
+
+    bad_files = [
+        ("an empty Code", "courses", with_row((99001, "", "Name") + first[3:]),
+         "1 record with an empty Code, the first is record 8"),
+        ("an id that is not an integer", "courses", with_row(("x1",) + first[1:]), "is not an integer"),
+        ("a duplicate id", "courses", with_row(good[3]), "bad.csv:10: row rejected"),
+        ("Credits that are not a number", "courses", with_row((99002,) + first[1:4] + ("five",) + first[5:]),
+         "Credits that are not a whole number"),
+        ("an unknown Faculty", "courses", with_row((99003,) + first[1:5] + ("No Such Faculty",) + first[6:]),
+         "Faculty missing from faculties"),
+        ("the id of no course", "subjectmap", rows(original, "subjectmap") + [(99004, "X", "Y", "z")],
+         "id matching no course"),
+    ]
+    before = digest(DATABASE)
+    for what, table, records, error in bad_files:
+        write_csv("bad.csv", columns(original, table), records)
+        rc, log = run_import("%s=bad.csv" % table)
+        check(rc == 1 and error in log and "unchanged" in log, "a row with %s fails the import" % what)
+        check(digest(DATABASE) == before, "a row with %s leaves the database untouched" % what)
+
+    with open("bad.csv", "w") as f:
+        f.write(",".join(names) + '\n1,"unterminated,2\n')
+    rc, log = run_import("courses=bad.csv")
+    check(rc == 1 and "unterminated quoted field" in log, "an unterminated CSV field fails the import")
+    with open("bad.json", "w") as f:
+        f.write('[{"id": 1, "Code": "A"}, {"id": 2 "Code": "B"}]')
+    rc, log = run_import("courses=bad.json")
+    check(rc == 1 and "expected ',' or '}'" in log, "malformed JSON fails the import")
+    check(digest(DATABASE) == before, "malformed files leave the database untouched")
+    check(not os.path.exists(DATABASE + ".import"), "a failed import leaves no temporary database")
+
+
+def main():
+    original = os.path.abspath(DATABASE)
+    before = digest(original)
+    work = tempfile.mkdtemp(prefix="import_test.")
+    try:
+        os.chdir(work)
+        for test in (test_round_trip, test_derived_subjectmap, test_kept_subjectmap, test_malformed):
+            shutil.copy(original, DATABASE)
+            test(original)
+    finally:
+        shutil.rmtree(work)
+    check(digest(original) == before, "the database of the repository is never touched")
+
+    print("import: %s" % ("%d failures" % failures if failures else "ok"))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plan.h"
+
+#define MAX_COURSES 120
+#define CODES 40 // distinct codes, fewer than courses so some share one
+
+static Catalog cat;
+static CatalogCourse courses[MAX_COURSES];
+static int failures;
+
+static void check(int ok, const char *test, const char *what, long a, long b)
+{
+    if (!ok)
+    {
+        printf("FAIL %s: %s (%ld, %ld)\n", test, what, a, b);
+        failures++;
+    }
+}
+
+static long score(int credits, int count)
+{
+    return (long)credits * (PLAN_MAX_COURSES + 1) - count;
+}
+
+/**
+ * @brief Exhaustive search state: the k best scores of every valid plan
+ */
+typedef struct {
+    const PlanQuery *query;
+    const uint32_t *candidates;
+    int n;
+    int used[CODES];
+    long best[PLAN_MAX_K];
+    int bestCount;
+} Brute;
+
+static void bruteOffer(Brute *b, long s)
+{
+    int k = b->query->topK;
+    if (b->bestCount == k && s <= b->best[k - 1])
+    {
+        return;
+    }
+    int pos = b->bestCount < k ? b->bestCount++ : k - 1;
+    while (pos > 0 && b->best[pos - 1] < s)
+    {
+        b->best[pos] = b->best[pos - 1];
+        pos--;
+    }
+    b->best[pos] = s;
+}
+
+/**
+ * @brief Tries every subset of the candidates from start on, on top of a
+ * plan of count courses worth credits
+ */
+static void bruteSearch(Brute *b, int start, int credits, int count)
+{
+    const PlanQuery *q = b->query;
+    if (count > 0 && credits >= q->minCredits && credits <= q->maxCredits)
+    {
+        bruteOffer(b, score(credits, count));
+    }
+    if (count == q->maxCourses)
+    {
+        return;
+    }
+    for (int j = start; j < b->n; j++)
+    {
+        const CatalogCourse *c = &cat.courses[b->candidates[j]];
+        if (b->used[c->code] || credits + c->credits > q->maxCredits)
+        {
+            continue;
+        }
+        b->used[c->code] = 1;
+        bruteSearch(b, j + 1, credits + c->credits, count + 1);
+        b->used[c->code] = 0;
+    }
+}
+
+/**
+ * @brief Runs planSearch and the exhaustive search on one query and
+ * compares the scores of their plans; every plan must also be valid
+ */
+static void compare(const char *test, const PlanQuery *q)
+{
+    PlanResult result;
+    Brute b;
+    uint32_t candidates[MAX_COURSES];
+    int includeCredits = 0;
+
+    memset(&b, 0, sizeof(b));
+    b.query = q;
+    b.candidates = candidates;
+    for (int i = 0; i < q->includeCount; i++)
+    {
+        b.used[cat.courses[q->include[i]].code] = 1;
+        includeCredits += cat.courses[q->include[i]].credits;
+    }
+    for (uint32_t i = 0; i < cat.courseCount; i++)
+    {
+        if (bitsetTest(q->allowed, i) && !b.used[cat.courses[i].code])
+        {
+            candidates[b.n++] = i;
+        }
+    }
+    bruteSearch(&b, 0, includeCredits, q->includeCount);
+
+    check(planSearch(&cat, q, &result) == 0, test, "search accepted", 0, 0);
+    check(result.complete, test, "search completed within its budget", result.nodes, 0);
+    check(result.count == b.bestCount, test, "as many plans as exhaustive search", result.count, b.bestCount);
+
+    for (int i = 0; i < result.count && i < b.bestCount; i++)
+    {
+        const Plan *plan = &result.plans[i];
+        int credits = 0, codes[CODES] = {0}, included = 0, valid = 1;
+        for (int j = 0; j < plan->count; j++)
+        {
+            uint32_t idx = plan->courses[j];
+            const CatalogCourse *c = &cat.courses[idx];
+            int isIncluded = 0;
+            for (int m = 0; m < q->includeCount; m++)
+            {
+                isIncluded |= q->include[m] == idx;
+            }
+            included += isIncluded;
+            valid &= isIncluded || bitsetTest(q->allowed, idx); // excluded courses never appear
+            valid &= !codes[c->code]++;
+            valid &= j == 0 || plan->courses[j - 1] < idx;
+            credits += c->credits;
+        }
+        check(valid, test, "plan uses allowed courses with distinct codes", i, plan->count);
+        check(included == q->includeCount, test, "plan contains every included course", i, included);
+        check(credits == plan->credits, test, "plan credits add up", credits, plan->credits);
+        check(credits >= q->minCredits && credits <= q->maxCredits, test, "plan credits in range", credits,
+              q->maxCredits);
+        check(plan->count <= q->maxCourses, test, "plan within maxcourses", plan->count, q->maxCourses);
+        check(score(credits, plan->count) == b.best[i], test, "plan as good as the exhaustive one",
+              score(credits, plan->count), b.best[i]);
+    }
+}
+
+/**
+ * @brief Fills the catalog with n courses of random credits and codes
+ */
+static void makeCatalog(int n)
+{
+    cat.courseCount = n;
+    cat.courses = courses;
+    cat.bitsetWords = (n + 63) / 64;
+    for (int i = 0; i < n; i++)
+    {
+        courses[i].id = i + 1;
+        courses[i].code = rand() % CODES;
+        courses[i].credits = 1 + rand() % 8;
+    }
+}
+
+/**
+ * @brief Random queries on small catalogs searched on one thread, and on
+ * catalogs large enough for the search to be split across workers
+ */
+static void testRandom(int catalogs, int maxCatalog, int maxCourses)
+{
+    uint64_t allowed[(MAX_COURSES + 63) / 64];
+    uint32_t include[PLAN_MAX_COURSES];
+    char test[64];
+
+    for (int round = 0; round < catalogs; round++)
+    {
+        makeCatalog(maxCatalog - rand() % (maxCatalog / 3 + 1));
+        snprintf(test, sizeof(test), "catalog %d of %u courses", round, cat.courseCount);
+
+        for (int query = 0; query < 8; query++)
+        {
+            PlanQuery q;
+            memset(&q, 0, sizeof(q));
+            q.minCredits = rand() % 12;
+            q.maxCredits = q.minCredits + rand() % 14;
+            q.topK = 1 + rand() % PLAN_MAX_K;
+            q.maxCourses = 1 + rand() % maxCourses;
+            q.budgetMs = 10000;
+            q.allowed = allowed;
+            q.include = include;
+
+            // exclude about one course in eight
+            memset(allowed, 0, sizeof(allowed));
+            for (uint32_t i = 0; i < cat.courseCount; i++)
+            {
+                if (rand() % 8)
+                {
+                    bitsetSet(allowed, i);
+                }
+            }
+            // include up to two courses with distinct codes
+            int wanted = rand() % 3;
+            for (int tries = 0; q.includeCount < wanted && q.includeCount < q.maxCourses && tries < 10; tries++)
+            {
+                uint32_t idx = rand() % cat.courseCount;
+                if (q.includeCount == 0 || cat.courses[include[0]].code != cat.courses[idx].code)
+                {
+                    include[q.includeCount++] = idx;
+                }
+            }
+            compare(test, &q);
+        }
+    }
+}
+
+/**
+ * @brief Queries planSearch must refuse
+ */
+static void testInvalid(void)
+{
+    uint64_t allowed[(MAX_COURSES + 63) / 64] = {0};
+    uint32_t include[2];
+    PlanResult result;
+    PlanQuery q = {10, 20, 5, 4, 1000, allowed, include, 0};
+
+    makeCatalog(10);
+    courses[1].code = courses[0].code;
+    q.minCredits = 21;
+    check(planSearch(&cat, &q, &result) < 0, "invalid", "min above max refused", 0, 0);
+    q.minCredits = 10;
+    q.topK = 0;
+    check(planSearch(&cat, &q, &result) < 0, "invalid", "k of 0 refused", 0, 0);
+    q.topK = 5;
+    q.maxCourses = PLAN_MAX_COURSES + 1;
+    check(planSearch(&cat, &q, &result) < 0, "invalid", "too many courses refused", 0, 0);
+    q.maxCourses = 4;
+    include[0] = 0;
+    include[1] = 1;
+    q.includeCount = 2;
+    check(planSearch(&cat, &q, &result) < 0, "invalid", "two included courses with one code refused", 0, 0);
+}
+
+int main(void)
+{
+    srand(2728);
+    testRandom(40, 18, 6);
+    testRandom(6, MAX_COURSES, 3); // above PARALLEL_MIN candidates
+    testInvalid();
+
+    if (failures)
+    {
+        printf("plan: %d failures\n", failures);
+        return 1;
+    }
+    printf("plan: ok\n");
+    return 0;
+}
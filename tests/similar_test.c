@@ -0,0 +1,156 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "similar.h"
+
+#define DATABASE "euroteq.db"
+#define COPIES 4      // copies of the catalog in the tiled one, above PARALLEL_MIN courses
+#define TOLERANCE 1e-4 // kernel and reference add up the products in different orders
+
+static Catalog cat;
+static int failures;
+
+static void check(int ok, const char *test, const char *what, long a, long b)
+{
+    if (!ok)
+    {
+        printf("FAIL %s: %s (%ld, %ld)\n", test, what, a, b);
+        failures++;
+    }
+}
+
+static int compareScores(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+/**
+ * @brief Scores every course of another university against course one
+ * product at a time; other courses score -1
+ */
+static void reference(const Catalog *c, uint32_t course, double *scores)
+{
+    const float *query = c->vectors + (size_t)course * c->vectorDims;
+    for (uint32_t i = 0; i < c->courseCount; i++)
+    {
+        const float *row = c->vectors + (size_t)i * c->vectorDims;
+        scores[i] = -1;
+        if (c->courses[i].value[DIM_UNI] != c->courses[course].value[DIM_UNI])
+        {
+            scores[i] = 0;
+            for (uint32_t d = 0; d < c->vectorDims; d++)
+            {
+                scores[i] += (double)query[d] * row[d];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Compares the k matches similarFind returns for course with the
+ * best k positive scores of the reference
+ */
+static void compare(const char *test, const Catalog *c, uint32_t course, int k, double *scores, double *sorted)
+{
+    SimilarMatch found[SIMILAR_MAX_K];
+    int count = similarFind(c, course, found, k);
+
+    reference(c, course, scores);
+    int positive = 0;
+    for (uint32_t i = 0; i < c->courseCount; i++)
+    {
+        if (scores[i] > 0)
+        {
+            sorted[positive++] = scores[i];
+        }
+    }
+    qsort(sorted, positive, sizeof(double), compareScores);
+
+    check(count == (positive < k ? positive : k), test, "as many matches as positive scores, up to k", count,
+          positive);
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t match = found[i].course;
+        check(match != course, test, "a course is never similar to itself", course, i);
+        check(scores[match] >= 0, test, "matches are courses of other universities", course, match);
+        check(fabs(found[i].score - scores[match]) < TOLERANCE, test, "score is the dot product", course, match);
+        check(fabs(found[i].score - sorted[i]) < TOLERANCE, test, "no better course is left out", course, i);
+        check(i == 0 || found[i - 1].score >= found[i].score, test, "best matches first", course, i);
+        for (int j = 0; j < i; j++)
+        {
+            check(found[j].course != match, test, "a course is returned once", course, match);
+        }
+    }
+}
+
+/**
+ * @brief Catalog of COPIES copies of cat, large enough for similarFind to
+ * split the rows across worker threads
+ */
+static int makeTiled(Catalog *tiled)
+{
+    size_t rowBytes = (size_t)cat.vectorDims * sizeof(float);
+    memset(tiled, 0, sizeof(*tiled));
+    tiled->courseCount = cat.courseCount * COPIES;
+    tiled->vectorDims = cat.vectorDims;
+    tiled->courses = malloc(tiled->courseCount * sizeof(CatalogCourse));
+    tiled->vectors = aligned_alloc(32, (tiled->courseCount * rowBytes + 31) / 32 * 32);
+    if (tiled->courses == NULL || tiled->vectors == NULL)
+    {
+        return -1;
+    }
+    for (int copy = 0; copy < COPIES; copy++)
+    {
+        memcpy(tiled->courses + copy * cat.courseCount, cat.courses, cat.courseCount * sizeof(CatalogCourse));
+        memcpy(tiled->vectors + copy * cat.courseCount * cat.vectorDims, cat.vectors, cat.courseCount * rowBytes);
+    }
+    return 0;
+}
+
+int main(void)
+{
+    Catalog tiled;
+    if (catalogLoad(&cat, DATABASE) < 0 || makeTiled(&tiled) < 0)
+    {
+        printf("similar: cannot load %s\n", DATABASE);
+        return 1;
+    }
+    double *scores = malloc(tiled.courseCount * sizeof(double));
+    double *sorted = malloc(tiled.courseCount * sizeof(double));
+    if (scores == NULL || sorted == NULL)
+    {
+        printf("similar: not enough memory\n");
+        return 1;
+    }
+
+    const int ks[] = {1, 10, SIMILAR_MAX_K};
+    for (uint32_t course = 0; course < cat.courseCount; course += 5)
+    {
+        compare("catalog", &cat, course, ks[course / 5 % 3], scores, sorted);
+    }
+    for (uint32_t course = 0; course < tiled.courseCount; course += 157)
+    {
+        compare("tiled catalog", &tiled, course, SIMILAR_MAX_K, scores, sorted);
+    }
+
+    SimilarMatch found[SIMILAR_MAX_K];
+    check(similarFind(&cat, 0, found, 0) < 0, "invalid", "k of 0 refused", 0, 0);
+    check(similarFind(&cat, 0, found, SIMILAR_MAX_K + 1) < 0, "invalid", "k above SIMILAR_MAX_K refused", 0, 0);
+    check(similarFind(&cat, cat.courseCount, found, 1) < 0, "invalid", "unknown course refused", 0, 0);
+
+    free(scores);
+    free(sorted);
+    free(tiled.courses);
+    free(tiled.vectors);
+    catalogFree(&cat);
+    if (failures)
+    {
+        printf("similar: %d failures\n", failures);
+        return 1;
+    }
+    printf("similar: ok\n");
+    return 0;
+}
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""Tests of the catalog snapshot at startup, run on a copy of euroteq.db
+in a temporary directory.
+
+Usage: tests/snapshot_test.py
+
+Builds a snapshot with server --snapshot, then starts the server on it
+and checks that a matching snapshot is mapped, and that a stale,
+truncated or corrupt one is reported and the catalog built from SQLite.
+"""
+
+import os
+import shutil
+import signal
+import socket
+import sqlite3
+import subprocess
+import sys
+import tempfile
+import time
+
+SERVER = os.path.abspath("server")
+DATABASE = "euroteq.db"
+SNAPSHOT = "euroteq.snap"
+HOST, PORT = "127.0.0.1", 2728
+
+failures = 0
+
+
+def check(ok, what):
+    global failures
+    if not ok:
+        print("FAIL", what)
+        failures += 1
+
+
+def start():
+    """Starts the server, stops it once it answers; returns its log"""
+    server = subprocess.Popen([SERVER], stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    # the socket listens before the catalog is loaded, so wait for a response
+    for _ in range(100):
+        try:
+            s = socket.create_connection((HOST, PORT), timeout=5)
+            s.sendall(b"GET /index/style.css HTTP/1.0\r\n\r\n")
+            s.recv(1)
+            s.close()
+            break
+        except OSError:
+            if server.poll() is not None:
+                break
+            time.sleep(0.05)
+    server.send_signal(signal.SIGINT)
+    return server.communicate()[1]
+
+
+def courses():
+    con = sqlite3.connect(DATABASE)
+    count = con.execute("SELECT COUNT(*) FROM courses").fetchone()[0]
+    con.close()
+    return count
+
+
+def mapped(log):
+    return "Mapped %d courses from catalog snapshot" % courses() in log
+
+
+def loaded(log):
+    return "Loaded %d courses into catalog" % courses() in log and "Mapped" not in log
+
+
+def rename_course(name):
+    # same length, so the file keeps its size
+    con = sqlite3.connect(DATABASE)
+    con.execute("UPDATE courses SET Course = ? WHERE id = (SELECT MIN(id) FROM courses)", (name,))
+    con.commit()
+    con.close()
+
+
+def test_fresh():
+    check(mapped(start()), "a snapshot of the database is mapped")
+
+
+def test_untouched():
+    # the same inode, size and mtime: the database is trusted without reading it
+    st = os.stat(DATABASE)
+    con = sqlite3.connect(DATABASE)
+    name = con.execute("SELECT Course FROM courses ORDER BY id LIMIT 1").fetchone()[0]
+    con.close()
+    rename_course(name[::-1])
+    os.utime(DATABASE, ns=(st.st_atime_ns, st.st_mtime_ns))
+    check(os.stat(DATABASE).st_size == st.st_size, "renaming a course keeps the size of the database")
+    check(mapped(start()), "a snapshot is mapped while the database file looks untouched")
+
+    # once the file looks changed, the fingerprint tells the tables changed
+    os.utime(DATABASE)
+    log = start()
+    check("is stale" in log and loaded(log), "a stale snapshot falls back to SQLite")
+
+
+def test_selection():
+    # saving a selection changes the file, not the catalog tables
+    con = sqlite3.connect(DATABASE)
+    con.execute("INSERT INTO selected SELECT * FROM courses LIMIT 1")
+    con.commit()
+    con.close()
+    check(mapped(start()), "a snapshot is mapped after a selection is saved")
+
+
+def test_truncated():
+    with open(SNAPSHOT, "r+b") as f:
+        f.truncate(os.path.getsize(SNAPSHOT) // 2)
+    log = start()
+    check("is truncated" in log and loaded(log), "a truncated snapshot falls back to SQLite")
+
+
+def test_corrupt():
+    with open(SNAPSHOT, "r+b") as f:
+        f.seek(os.path.getsize(SNAPSHOT) // 2)
+        byte = f.read(1)
+        f.seek(-1, os.SEEK_CUR)
+        f.write(bytes([byte[0] ^ 0xff]))
+    log = start()
+    check("is corrupt" in log and loaded(log), "a corrupt snapshot falls back to SQLite")
+
+
+def main():
+    repository = os.getcwd()
+    work = tempfile.mkdtemp(prefix="snapshot_test.")
+    try:
+        os.chdir(work)
+        for directory in ("htdocs", "templates"):
+            os.symlink(os.path.join(repository, directory), directory)
+        for test in (test_fresh, test_untouched, test_selection, test_truncated, test_corrupt):
+            shutil.copy(os.path.join(repository, DATABASE), DATABASE)
+            subprocess.run([SERVER, "--snapshot"], capture_output=True, check=True)
+            test()
+    finally:
+        os.chdir(repository)
+        shutil.rmtree(work)
+
+    print("snapshot: %s" % ("%d failures" % failures if failures else "ok"))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
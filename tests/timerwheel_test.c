@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "timerwheel.h"
+
+#define LIMIT (((uint64_t)1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1) // farthest tick the wheel holds
+#define MAX_TIMERS 64
+
+typedef struct {
+    Timer timer;
+    uint64_t deadline; // tick the timer was scheduled for
+    int fired;
+    uint64_t firedAt;
+    int early; // firings before the deadline
+    int late;  // firings after the tick of the deadline
+    int rearm; // times the callback schedules the timer again
+    uint64_t period;
+} TestTimer;
+
+static TimerWheel wheel;
+static int failures;
+
+static void check(int ok, const char *test, const char *what, uint64_t a, uint64_t b)
+{
+    if (!ok)
+    {
+        printf("FAIL %s: %s (%llu, %llu)\n", test, what, (unsigned long long)a, (unsigned long long)b);
+        failures++;
+    }
+}
+
+static void fire(Timer *timer)
+{
+    TestTimer *t = (TestTimer *)((char *)timer - offsetof(TestTimer, timer));
+    t->fired++;
+    t->firedAt = wheel.now;
+    t->early += wheel.now < t->deadline;
+    t->late += wheel.now > t->deadline;
+    if (t->rearm > 0)
+    {
+        t->rearm--;
+        t->deadline = wheel.now + t->period;
+        timerSchedule(&wheel, timer, t->deadline);
+    }
+}
+
+static void schedule(TestTimer *t, uint64_t deadline)
+{
+    t->timer.callback = fire;
+    t->deadline = deadline;
+    timerSchedule(&wheel, &t->timer, deadline);
+}
+
+/**
+ * @brief Schedules one timer just before, at and after each level
+ * boundary and advances by step ticks at a time until all have fired
+ */
+static void testBoundaries(uint64_t start, uint64_t step)
+{
+    static const uint64_t deltas[] = {
+        0, 1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 262145, LIMIT, LIMIT + 1, LIMIT + 1000,
+    };
+    const int count = sizeof(deltas) / sizeof(deltas[0]);
+    TestTimer timers[sizeof(deltas) / sizeof(deltas[0])] = {0};
+    char test[64];
+    snprintf(test, sizeof(test), "boundaries start=%llu step=%llu", (unsigned long long)start,
+             (unsigned long long)step);
+
+    timerWheelInit(&wheel, start);
+    for (int i = 0; i < count; i++)
+    {
+        schedule(&timers[i], start + deltas[i]);
+    }
+
+    uint64_t end = start + LIMIT + 1000 + step;
+    while (wheel.now < end)
+    {
+        uint64_t before = wheel.now;
+        timerAdvance(&wheel, wheel.now + step);
+        for (int i = 0; i < count; i++)
+        {
+            TestTimer *t = &timers[i];
+            // due within this step: fired during it, never before its deadline
+            if (t->deadline <= wheel.now)
+            {
+                check(t->fired == 1, test, "fired once by its deadline", t->deadline, t->fired);
+                check(t->firedAt >= t->deadline || t->deadline <= start, test, "fired at or after deadline",
+                      t->deadline, t->firedAt);
+                check(t->firedAt <= (t->deadline > before ? t->deadline : before + 1), test,
+                      "fired in the tick it was due", t->deadline, t->firedAt);
+            }
+            else
+            {
+                check(t->fired == 0, test, "not fired before its deadline", t->deadline, t->firedAt);
+            }
+        }
+    }
+    check(wheel.count == 0, test, "wheel empty at the end", wheel.count, 0);
+}
+
+/**
+ * @brief Timers that schedule themselves again from their callback
+ */
+static void testRearm(void)
+{
+    static const uint64_t periods[] = {1, 63, 64, 100, 4096, 5000, 262144};
+    const int count = sizeof(periods) / sizeof(periods[0]);
+    TestTimer timers[sizeof(periods) / sizeof(periods[0])] = {0};
+
+    timerWheelInit(&wheel, 1000);
+    for (int i = 0; i < count; i++)
+    {
+        timers[i].rearm = 4;
+        timers[i].period = periods[i];
+        schedule(&timers[i], wheel.now + periods[i]);
+    }
+    while (wheel.count > 0)
+    {
+        timerAdvance(&wheel, wheel.now + 1);
+    }
+    for (int i = 0; i < count; i++)
+    {
+        check(timers[i].fired == 5, "rearm", "fired once per arming", periods[i], timers[i].fired);
+        check(timers[i].early == 0 && timers[i].late == 0, "rearm", "fired exactly at each deadline", periods[i],
+              timers[i].early + timers[i].late);
+        check(timers[i].firedAt == 1000 + 5 * periods[i], "rearm", "last firing on time", periods[i],
+              timers[i].firedAt);
+    }
+}
+
+/**
+ * @brief Cancelled timers never fire; moved timers fire only at their new
+ * deadline, including moves between levels
+ */
+static void testCancelAndMove(void)
+{
+    TestTimer timers[MAX_TIMERS] = {0};
+
+    timerWheelInit(&wheel, 77);
+    for (int i = 0; i < MAX_TIMERS; i++)
+    {
+        // spread over all levels
+        schedule(&timers[i], wheel.now + ((uint64_t)1 << (i % 24)) + i);
+    }
+    for (int i = 0; i < MAX_TIMERS; i += 3)
+    {
+        timerCancel(&wheel, &timers[i].timer);
+        timerCancel(&wheel, &timers[i].timer); // twice is harmless
+    }
+    for (int i = 1; i < MAX_TIMERS; i += 3)
+    {
+        // far timers come near and near ones go far
+        uint64_t deadline = timers[i].deadline - wheel.now > 4096 ? wheel.now + 10 + i : wheel.now + 300000 + i;
+        schedule(&timers[i], deadline);
+    }
+    check(wheel.count == MAX_TIMERS - (MAX_TIMERS + 2) / 3, "cancel", "count after cancel", wheel.count, 0);
+
+    uint64_t end = wheel.now + ((uint64_t)1 << 24) + MAX_TIMERS;
+    while (wheel.now < end)
+    {
+        timerAdvance(&wheel, wheel.now + 1);
+    }
+    for (int i = 0; i < MAX_TIMERS; i++)
+    {
+        if (i % 3 == 0)
+        {
+            check(timers[i].fired == 0, "cancel", "cancelled timer did not fire", i, timers[i].fired);
+        }
+        else
+        {
+            check(timers[i].fired == 1, "cancel", "fired once", i, timers[i].fired);
+            check(timers[i].firedAt == timers[i].deadline, "cancel", "fired at its deadline", timers[i].deadline,
+                  timers[i].firedAt);
+        }
+    }
+    check(wheel.count == 0, "cancel", "wheel empty at the end", wheel.count, 0);
+}
+
+int main(void)
+{
+    // tick by tick, in strides that cross the level boundaries, and from
+    // starts just before them
+    testBoundaries(0, 1);
+    testBoundaries(4095, 1);
+    testBoundaries(262140, 7);
+    testBoundaries(123, 4096);
+    testBoundaries(5, 262144);
+    testRearm();
+    testCancelAndMove();
+
+    if (failures)
+    {
+        printf("timerwheel: %d failures\n", failures);
+        return 1;
+    }
+    printf("timerwheel: ok\n");
+    return 0;
+}
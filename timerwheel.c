@@ -0,0 +1,140 @@
+#include <stddef.h>
+
+#include "timerwheel.h"
+
+void timerWheelInit(TimerWheel *wheel, uint64_t now)
+{
+    wheel->now = now;
+    wheel->count = 0;
+    for (int level = 0; level < WHEEL_LEVELS; level++)
+    {
+        for (int slot = 0; slot < WHEEL_SLOTS; slot++)
+        {
+            Timer *head = &wheel->slots[level][slot];
+            head->next = head->prev = head;
+        }
+    }
+}
+
+static void wheelLink(TimerWheel *wheel, Timer *timer)
+{
+    uint64_t delta = timer->expires > wheel->now ? timer->expires - wheel->now : 0;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (uint64_t)1 << (WHEEL_BITS * (level + 1)))
+    {
+        level++;
+    }
+
+    uint64_t expires = timer->expires > wheel->now ? timer->expires : wheel->now;
+    uint64_t limit = ((uint64_t)1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    if (delta > limit)
+    {
+        // beyond the wheel: park in the farthest slot, re-cascaded until due
+        expires = wheel->now + limit;
+    }
+    Timer *head = &wheel->slots[level][(expires >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)];
+
+    timer->next = head->next;
+    timer->prev = head;
+    head->next->prev = timer;
+    head->next = timer;
+}
+
+static void wheelUnlink(Timer *timer)
+{
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->next = timer->prev = NULL;
+}
+
+void timerSchedule(TimerWheel *wheel, Timer *timer, uint64_t expires)
+{
+    if (timer->next)
+    {
+        wheelUnlink(timer);
+    }
+    else
+    {
+        wheel->count++;
+    }
+    // a timer already due runs on the next tick; the slot of now has been run
+    timer->expires = expires > wheel->now ? expires : wheel->now + 1;
+    wheelLink(wheel, timer);
+}
+
+void timerCancel(TimerWheel *wheel, Timer *timer)
+{
+    if (timer->next)
+    {
+        wheelUnlink(timer);
+        wheel->count--;
+    }
+}
+
+/**
+ * @brief Re-links the timers of one upper-level slot into lower levels
+ */
+static void cascade(TimerWheel *wheel, int level)
+{
+    Timer *head = &wheel->slots[level][(wheel->now >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)];
+    Timer *timer = head->next;
+    head->next = head->prev = head;
+    while (timer != head)
+    {
+        Timer *next = timer->next;
+        wheelLink(wheel, timer);
+        timer = next;
+    }
+}
+
+void timerAdvance(TimerWheel *wheel, uint64_t now)
+{
+    while (wheel->now < now)
+    {
+        wheel->now++;
+
+        // entering a new lap of a level pulls the next slot of the level above
+        for (int level = 1; level < WHEEL_LEVELS; level++)
+        {
+            if (wheel->now & ((1 << (WHEEL_BITS * level)) - 1))
+            {
+                break;
+            }
+            cascade(wheel, level);
+        }
+
+        Timer *head = &wheel->slots[0][wheel->now & (WHEEL_SLOTS - 1)];
+        while (head->next != head)
+        {
+            Timer *timer = head->next;
+            wheelUnlink(timer);
+            wheel->count--;
+            timer->callback(timer);
+        }
+
+        // nothing scheduled: jump straight to now
+        if (wheel->count == 0)
+        {
+            wheel->now = now;
+        }
+    }
+}
+
+long timerIdleTicks(const TimerWheel *wheel)
+{
+    if (wheel->count == 0)
+    {
+        return -1;
+    }
+    // first busy level-0 slot before the next cascade
+    uint64_t slot = wheel->now & (WHEEL_SLOTS - 1);
+    for (uint64_t i = 1; slot + i < WHEEL_SLOTS; i++)
+    {
+        const Timer *head = &wheel->slots[0][slot + i];
+        if (head->next != head)
+        {
+            return i;
+        }
+    }
+    return WHEEL_SLOTS - slot;
+}
@@ -0,0 +1,56 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stdint.h>
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS) // slots per level
+#define WHEEL_LEVELS 4                // covers 2^24 ticks
+
+/**
+ * @brief Timer embedded in the object it belongs to. The callback runs
+ * once the wheel reaches the expiry tick; the timer is already unlinked
+ * then, so the callback may schedule it again or free its owner.
+ */
+typedef struct Timer {
+    struct Timer *next;
+    struct Timer *prev;
+    uint64_t expires; // tick
+    void (*callback)(struct Timer *timer);
+} Timer;
+
+/**
+ * @brief Hierarchical timer wheel: level 0 holds timers due within
+ * WHEEL_SLOTS ticks, each further level covers WHEEL_SLOTS times more and
+ * is cascaded down as time reaches it. Scheduling and cancelling are O(1).
+ */
+typedef struct {
+    uint64_t now; // current tick
+    long count;   // scheduled timers
+    Timer slots[WHEEL_LEVELS][WHEEL_SLOTS]; // list heads
+} TimerWheel;
+
+void timerWheelInit(TimerWheel *wheel, uint64_t now);
+
+/**
+ * @brief Schedules timer at tick expires, moving it if already scheduled
+ */
+void timerSchedule(TimerWheel *wheel, Timer *timer, uint64_t expires);
+
+/**
+ * @brief Unschedules timer; does nothing if it is not scheduled
+ */
+void timerCancel(TimerWheel *wheel, Timer *timer);
+
+/**
+ * @brief Moves the wheel to tick now, running every timer due by then
+ */
+void timerAdvance(TimerWheel *wheel, uint64_t now);
+
+/**
+ * @brief Returns how many ticks the wheel may sleep before it has to be
+ * advanced again, or -1 when no timer is scheduled
+ */
+long timerIdleTicks(const TimerWheel *wheel);
+
+#endif
@@ -0,0 +1,233 @@
+#define _GNU_SOURCE // syscall
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+// no liburing: the three system calls are made directly
+
+static int uringSetup(unsigned entries, struct io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uringEnter(int fd, unsigned submit, unsigned wait, unsigned flags, void *arg, size_t argSize)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, submit, wait, flags, arg, argSize);
+}
+
+static int uringRegister(int fd, unsigned opcode, void *arg, unsigned count)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+int uringInit(Uring *ring, unsigned entries)
+{
+    struct io_uring_params params;
+    memset(ring, 0, sizeof(Uring));
+    memset(&params, 0, sizeof(params));
+
+    // the request loop is the only submitter and reaps completions itself
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+    ring->fd = uringSetup(entries, &params);
+    if (ring->fd < 0 && errno == EINVAL)
+    {
+        memset(&params, 0, sizeof(params));
+        ring->fd = uringSetup(entries, &params);
+    }
+    if (ring->fd < 0)
+    {
+        return -1;
+    }
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP))
+    {
+        close(ring->fd);
+        ring->fd = -1;
+        errno = ENOSYS;
+        return -1;
+    }
+
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+    ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqRing == MAP_FAILED || ring->cqRing == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        uringFree(ring);
+        return -1;
+    }
+
+    char *sq = ring->sqRing;
+    char *cq = ring->cqRing;
+    ring->sqEntries = params.sq_entries;
+    ring->sqHead = (unsigned *)(sq + params.sq_off.head);
+    ring->sqTail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sqLocalTail = *ring->sqTail;
+    ring->cqHead = (unsigned *)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    // slot i of the submission array always points at entry i
+    unsigned *array = (unsigned *)(sq + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; i++)
+    {
+        array[i] = i;
+    }
+    return 0;
+}
+
+void uringFree(Uring *ring)
+{
+    if (ring->sqRing && ring->sqRing != MAP_FAILED)
+    {
+        munmap(ring->sqRing, ring->sqRingSize);
+    }
+    if (ring->cqRing && ring->cqRing != MAP_FAILED)
+    {
+        munmap(ring->cqRing, ring->cqRingSize);
+    }
+    if (ring->sqes && ring->sqes != MAP_FAILED)
+    {
+        munmap(ring->sqes, ring->sqesSize);
+    }
+    close(ring->fd);
+    memset(ring, 0, sizeof(Uring));
+    ring->fd = -1;
+}
+
+/**
+ * @brief Hands queued entries to the kernel without waiting
+ */
+static void uringFlush(Uring *ring)
+{
+    __atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+    unsigned queued = ring->sqLocalTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+    while (queued > 0 && uringEnter(ring->fd, queued, 0, 0, NULL, 0) < 0 && errno == EINTR)
+    {
+    }
+}
+
+void uringReserve(Uring *ring, unsigned n)
+{
+    if (ring->sqLocalTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) + n > ring->sqEntries)
+    {
+        uringFlush(ring);
+    }
+}
+
+struct io_uring_sqe *uringSqe(Uring *ring)
+{
+    uringReserve(ring, 1);
+    struct io_uring_sqe *sqe = &ring->sqes[ring->sqLocalTail & *ring->sqMask];
+    ring->sqLocalTail++;
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    return sqe;
+}
+
+struct io_uring_sqe *uringPrep(Uring *ring, int opcode, int fd, const void *addr, unsigned len,
+                               uint64_t userData)
+{
+    struct io_uring_sqe *sqe = uringSqe(ring);
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)addr;
+    sqe->len = len;
+    sqe->user_data = userData;
+    return sqe;
+}
+
+int uringSubmit(Uring *ring, int timeoutMs)
+{
+    __atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+    unsigned queued = ring->sqLocalTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+
+    int result;
+    if (timeoutMs == 0)
+    {
+        result = queued ? uringEnter(ring->fd, queued, 0, 0, NULL, 0) : 0;
+    }
+    else if (timeoutMs < 0)
+    {
+        result = uringEnter(ring->fd, queued, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    }
+    else
+    {
+        struct __kernel_timespec ts = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000LL};
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        result = uringEnter(ring->fd, queued, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                            &arg, sizeof(arg));
+    }
+
+    // a timeout or signal just ends the wait
+    return result < 0 && errno != ETIME && errno != EINTR && errno != EBUSY ? -1 : 0;
+}
+
+struct io_uring_cqe *uringPeek(Uring *ring)
+{
+    unsigned head = *ring->cqHead;
+    if (head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+    {
+        return NULL;
+    }
+    return &ring->cqes[head & *ring->cqMask];
+}
+
+void uringSeen(Uring *ring)
+{
+    __atomic_store_n(ring->cqHead, *ring->cqHead + 1, __ATOMIC_RELEASE);
+}
+
+int uringBuffersInit(Uring *ring, UringBuffers *buffers, uint16_t group, unsigned count, unsigned size)
+{
+    buffers->count = count;
+    buffers->size = size;
+    buffers->group = group;
+    buffers->ring = mmap(NULL, count * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    buffers->base = mmap(NULL, (size_t)count * size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers->ring == MAP_FAILED || buffers->base == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)buffers->ring;
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (uringRegister(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        return -1;
+    }
+
+    for (unsigned id = 0; id < count; id++)
+    {
+        uringBufferRecycle(buffers, id);
+    }
+    return 0;
+}
+
+void uringBufferRecycle(UringBuffers *buffers, uint16_t id)
+{
+    uint16_t tail = buffers->ring->tail;
+    struct io_uring_buf *buf = &buffers->ring->bufs[tail & (buffers->count - 1)];
+    buf->addr = (uint64_t)(uintptr_t)uringBuffer(buffers, id);
+    buf->len = buffers->size;
+    buf->bid = id;
+    __atomic_store_n(&buffers->ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
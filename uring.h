@@ -0,0 +1,103 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/io_uring.h>
+
+/**
+ * @brief Submission and completion queues of an io_uring instance, mapped
+ * into the process. Only one thread may use a ring.
+ */
+typedef struct {
+    int fd;
+    unsigned sqEntries;
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    struct io_uring_sqe *sqes;
+    unsigned sqLocalTail; // queued entries not yet handed to the kernel
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+    void *sqRing;
+    size_t sqRingSize;
+    void *cqRing;
+    size_t cqRingSize;
+    size_t sqesSize;
+} Uring;
+
+/**
+ * @brief Ring of equally sized receive buffers the kernel picks from
+ * (IOSQE_BUFFER_SELECT); the chosen buffer id comes back in the completion
+ */
+typedef struct {
+    struct io_uring_buf_ring *ring;
+    char *base;
+    unsigned count; // power of two
+    unsigned size;
+    uint16_t group;
+} UringBuffers;
+
+/**
+ * @brief Creates a ring with room for entries submissions
+ * @return 0 on success, -1 with errno set on failure
+ */
+int uringInit(Uring *ring, unsigned entries);
+
+void uringFree(Uring *ring);
+
+/**
+ * @brief Returns a zeroed submission entry, flushing queued entries to the
+ * kernel first if the queue is full
+ */
+struct io_uring_sqe *uringSqe(Uring *ring);
+
+/**
+ * @brief Makes sure the next n entries are queued in the same submission,
+ * so a linked chain is not split between two
+ */
+void uringReserve(Uring *ring, unsigned n);
+
+/**
+ * @brief Fills a submission entry for a socket operation
+ */
+struct io_uring_sqe *uringPrep(Uring *ring, int opcode, int fd, const void *addr, unsigned len,
+                               uint64_t userData);
+
+/**
+ * @brief Submits queued entries and waits for a completion
+ * @param timeoutMs longest wait, 0 to only submit, -1 to wait without limit
+ * @return 0 on success or timeout, -1 with errno set on failure
+ */
+int uringSubmit(Uring *ring, int timeoutMs);
+
+/**
+ * @brief Returns the oldest unseen completion or NULL
+ */
+struct io_uring_cqe *uringPeek(Uring *ring);
+
+/**
+ * @brief Hands the completion returned by uringPeek back to the kernel
+ */
+void uringSeen(Uring *ring);
+
+/**
+ * @brief Allocates count buffers of size bytes and registers them as
+ * buffer group group of the ring
+ * @return 0 on success, -1 with errno set on failure
+ */
+int uringBuffersInit(Uring *ring, UringBuffers *buffers, uint16_t group, unsigned count, unsigned size);
+
+static inline char *uringBuffer(const UringBuffers *buffers, uint16_t id)
+{
+    return buffers->base + (size_t)id * buffers->size;
+}
+
+/**
+ * @brief Gives buffer id back to the kernel once its data was consumed
+ */
+void uringBufferRecycle(UringBuffers *buffers, uint16_t id);
+
+#endif